@@ -0,0 +1,311 @@
+//
+// Created by user on 10/15/26.
+//
+
+#ifndef QUANTDREAMCPP_THREAD_POOL_H
+#define QUANTDREAMCPP_THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace qd::parallel {
+
+/**
+ * Work-stealing thread pool.
+ * Every worker owns a deque: the tasks it spawns are pushed and popped at the back (newest first,
+ * which keeps nested work cache-warm), while idle workers steal from the front of the others'
+ * deques (oldest, usually largest, first). Tasks submitted from outside the pool go to a shared
+ * injection queue.
+ *
+ * Waiting is cooperative: TaskGroup::wait() and parallel_for() run the tasks of their own group
+ * that no worker has started yet on the waiting thread. A parallel loop started inside a pool
+ * task therefore spreads over the same workers instead of starting threads of its own, so
+ * nested parallelism (a parallel sweep of parallel simulations) never runs more threads than
+ * the pool has. A waiter never picks up unrelated work, so a short nested wait is not held up
+ * by a long task of another group.
+ * Blocking on a std::future from submit() inside a task does not help in this way: use a
+ * TaskGroup there.
+ */
+class ThreadPool {
+public:
+  /**
+   * @param nThreads Number of workers; 0 selects std::thread::hardware_concurrency().
+   */
+  explicit ThreadPool(const std::size_t nThreads = 0)
+      : nWorkers_(nThreads > 0 ? nThreads : std::max(1u, std::thread::hardware_concurrency())) {
+    for (std::size_t i = 0; i <= nWorkers_; ++i) queues_.push_back(std::make_unique<Queue>());
+    threads_.reserve(nWorkers_);
+    for (std::size_t i = 0; i < nWorkers_; ++i) threads_.emplace_back([this, i]() { work_(i); });
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  /**
+   * Runs every task already queued, then joins the workers.
+   */
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(sleepMutex_);
+      stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto &thread : threads_) thread.join();
+  }
+
+  /**
+   * Pool shared by the library, sized to the hardware concurrency and created on first use.
+   */
+  static ThreadPool &global() {
+    static ThreadPool pool;
+    return pool;
+  }
+
+  [[nodiscard]] std::size_t size() const { return nWorkers_; }
+
+  /**
+   * @return Index of the calling worker, or size() when the caller is not a worker of this pool.
+   */
+  [[nodiscard]] std::size_t worker_index() const { return currentPool_ == this ? currentIndex_ : size(); }
+
+  /**
+   * Queue a callable and get its result (or exception) through a future.
+   */
+  template<class F>
+  auto submit(F &&f) -> std::future<std::invoke_result_t<std::decay_t<F> &>> {
+    using Result = std::invoke_result_t<std::decay_t<F> &>;
+    auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(f));
+    std::future<Result> future = task->get_future();
+    push_([task]() { (*task)(); });
+    return future;
+  }
+
+  /**
+   * Run one queued task on the calling thread: the caller's own newest task if it is a worker,
+   * else the oldest injected one, else one stolen from another worker.
+   * @return false when every queue was empty.
+   */
+  bool run_pending_task() {
+    Task task;
+    if (!pop_(worker_index(), task)) return false;
+    task();
+    return true;
+  }
+
+  /**
+   * Run body(first, last) over nChunks contiguous chunks of [0, n) and wait for all of them.
+   * The calling thread runs the first chunk itself, then the chunks no worker has started.
+   * The first exception thrown by a chunk is rethrown here.
+   */
+  void parallel_for(std::size_t n, std::size_t nChunks, const std::function<void(std::size_t, std::size_t)> &body);
+
+private:
+  friend class TaskGroup;
+
+  using Task = std::function<void()>;
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  const std::size_t nWorkers_;
+  std::vector<std::unique_ptr<Queue>> queues_;  // One per worker, then the injection queue
+  std::vector<std::thread> threads_;
+  std::mutex sleepMutex_;
+  std::condition_variable wake_;
+  std::atomic<std::size_t> pending_{0};          // Tasks queued and not yet taken
+  bool stop_ = false;                            // Guarded by sleepMutex_
+
+  inline static thread_local const ThreadPool *currentPool_ = nullptr;
+  inline static thread_local std::size_t currentIndex_ = 0;
+
+  void push_(Task task) {
+    const std::size_t self = worker_index();
+    Queue &queue = *queues_[self];
+    {
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      queue.tasks.push_back(std::move(task));
+    }
+    pending_.fetch_add(1);
+    // Taking the lock orders the increment with a worker about to sleep, so the wake-up is not lost
+    { std::lock_guard<std::mutex> lock(sleepMutex_); }
+    wake_.notify_one();
+  }
+
+  bool pop_(const std::size_t self, Task &task) {
+    const std::size_t nWorkers = size();
+    if (pending_.load() == 0) return false;
+
+    // Own deque from the back
+    if (self < nWorkers) {
+      Queue &queue = *queues_[self];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      if (!queue.tasks.empty()) {
+        task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+        pending_.fetch_sub(1);
+        return true;
+      }
+    }
+
+    // Injection queue, then the other workers, from the front
+    for (std::size_t k = 0; k <= nWorkers; ++k) {
+      const std::size_t victim = (self + 1 + k) % (nWorkers + 1);
+      if (victim == self) continue;
+      Queue &queue = *queues_[victim];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      if (!queue.tasks.empty()) {
+        task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+        pending_.fetch_sub(1);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void work_(const std::size_t index) {
+    currentPool_ = this;
+    currentIndex_ = index;
+    for (;;) {
+      Task task;
+      if (pop_(index, task)) {
+        task();
+        continue;
+      }
+
+      std::unique_lock<std::mutex> lock(sleepMutex_);
+      wake_.wait(lock, [this]() { return stop_ || pending_.load() > 0; });
+      if (stop_ && pending_.load() == 0) return;
+    }
+  }
+};
+
+/**
+ * Set of tasks run on a pool and waited for together. wait() runs the group's tasks that no
+ * worker has claimed yet, so groups can be nested freely inside pool tasks: every unclaimed task
+ * is run by the waiter and every claimed one is already running elsewhere.
+ */
+class TaskGroup {
+public:
+  explicit TaskGroup(ThreadPool &pool = ThreadPool::global()) : pool_(pool) {}
+
+  TaskGroup(const TaskGroup &) = delete;
+  TaskGroup &operator=(const TaskGroup &) = delete;
+
+  /**
+   * Waits for the tasks still running; their exceptions are dropped.
+   */
+  ~TaskGroup() { wait_(); }
+
+  template<class F>
+  void run(F &&f) {
+    outstanding_.fetch_add(1);
+    auto callable = std::make_shared<std::decay_t<F>>(std::forward<F>(f));
+    auto entry = std::make_shared<Entry>();
+    entry->body = [this, callable]() {
+      try {
+        (*callable)();
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!error_) error_ = std::current_exception();
+      }
+      finish_();
+    };
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      unclaimed_.push_back(entry);
+    }
+    done_.notify_all();
+    // The pool's copy only holds the entry: once the waiter has run it, the group may be gone
+    pool_.push_([entry]() { entry->claim(); });
+  }
+
+  /**
+   * Wait for every task of the group, running its unclaimed tasks meanwhile.
+   * Rethrows the first exception thrown by a task.
+   */
+  void wait() {
+    wait_();
+    if (error_) std::rethrow_exception(std::exchange(error_, nullptr));
+  }
+
+private:
+  // One task, run by whichever of the pool and the waiter claims it first
+  struct Entry {
+    std::atomic<bool> claimed{false};
+    std::function<void()> body;
+
+    bool claim() {
+      if (claimed.exchange(true)) return false;
+      body();
+      return true;
+    }
+  };
+
+  ThreadPool &pool_;
+  std::atomic<std::size_t> outstanding_{0};
+  std::mutex mutex_;
+  std::condition_variable done_;
+  std::exception_ptr error_;
+  std::deque<std::shared_ptr<Entry>> unclaimed_;  // Newest at the back; guarded by mutex_
+
+  void finish_() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (outstanding_.fetch_sub(1) == 1) done_.notify_all();
+  }
+
+  void wait_() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+      // Newest first, like a worker on its own deque; entries a worker took are skipped
+      while (!unclaimed_.empty()) {
+        const std::shared_ptr<Entry> entry = std::move(unclaimed_.back());
+        unclaimed_.pop_back();
+        lock.unlock();
+        entry->claim();
+        lock.lock();
+      }
+      // The rest is running elsewhere, and may still add tasks to the group
+      if (outstanding_.load() == 0) break;
+      done_.wait(lock, [this]() { return outstanding_.load() == 0 || !unclaimed_.empty(); });
+    }
+    // Holding the mutex here also lets the last finish_() release it before the group goes away
+  }
+};
+
+inline void ThreadPool::parallel_for(const std::size_t n,
+                                     std::size_t nChunks,
+                                     const std::function<void(std::size_t, std::size_t)> &body) {
+  if (n == 0) return;
+  nChunks = std::max<std::size_t>(1, std::min(nChunks, n));
+  const std::size_t chunk = (n + nChunks - 1) / nChunks;
+  if (chunk >= n) {
+    body(0, n);
+    return;
+  }
+
+  TaskGroup group(*this);
+  for (std::size_t first = chunk; first < n; first += chunk) {
+    const std::size_t last = std::min(n, first + chunk);
+    group.run([&body, first, last]() { body(first, last); });
+  }
+  body(0, chunk);
+  group.wait();
+}
+
+}  // namespace qd::parallel
+
+#endif  // QUANTDREAMCPP_THREAD_POOL_H
@@ -0,0 +1,98 @@
+//
+// Created by user on 10/15/26.
+//
+
+#ifndef QUANTDREAMCPP_PHILOX_H
+#define QUANTDREAMCPP_PHILOX_H
+
+#include <array>
+#include <cstdint>
+#include <limits>
+
+namespace qd::random {
+
+/**
+ * Counter-based Philox4x32-10 generator (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3").
+ * The i-th output is a pure function of (key, stream, substream, i): there is no hidden state to
+ * replay, so any stream can be started, skipped or regenerated independently of the others.
+ * It satisfies UniformRandomBitGenerator and can be used with the <random> distributions.
+ *
+ * The 128-bit counter is laid out as [position, substream, stream_lo, stream_hi]
+ * and the 64-bit key holds the seed.
+ */
+class Philox4x32 {
+public:
+  using result_type = std::uint32_t;
+
+  /**
+   * @param key Seed shared by every stream.
+   * @param stream Identifier of the stream (e.g. a scenario index).
+   * @param substream Secondary identifier (e.g. a run number).
+   */
+  explicit Philox4x32(const std::uint64_t key = 0,
+                      const std::uint64_t stream = 0,
+                      const std::uint32_t substream = 0)
+    : key_{static_cast<std::uint32_t>(key), static_cast<std::uint32_t>(key >> 32)},
+      counter_{0, substream, static_cast<std::uint32_t>(stream),
+               static_cast<std::uint32_t>(stream >> 32)} {}
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+  result_type operator()() {
+    if (index_ == 4) {
+      output_ = block(counter_, key_);
+      ++counter_[0];
+      index_ = 0;
+    }
+    return output_[index_++];
+  }
+
+  /**
+   * Jump ahead by n outputs in O(1).
+   * @param n Number of outputs to skip.
+   */
+  void discard(const unsigned long long n) {
+    const unsigned long long position = static_cast<unsigned long long>(counter_[0]) * 4
+                                        - (4 - index_) + n;
+    counter_[0] = static_cast<std::uint32_t>(position / 4);
+    index_ = 4;
+    for (unsigned long long i = 0; i < position % 4; ++i) (*this)();
+  }
+
+  /**
+   * Apply the ten Philox rounds to one counter value.
+   * @param counter 128-bit counter.
+   * @param key 64-bit key.
+   * @return The four 32-bit outputs for this counter.
+   */
+  static std::array<std::uint32_t, 4> block(std::array<std::uint32_t, 4> counter,
+                                            std::array<std::uint32_t, 2> key) {
+    for (int round = 0; round < 10; ++round) {
+      const std::uint64_t p0 = static_cast<std::uint64_t>(kMultiplier0) * counter[0];
+      const std::uint64_t p1 = static_cast<std::uint64_t>(kMultiplier1) * counter[2];
+      counter = {static_cast<std::uint32_t>(p1 >> 32) ^ counter[1] ^ key[0],
+                 static_cast<std::uint32_t>(p1),
+                 static_cast<std::uint32_t>(p0 >> 32) ^ counter[3] ^ key[1],
+                 static_cast<std::uint32_t>(p0)};
+      key[0] += kWeyl0;
+      key[1] += kWeyl1;
+    }
+    return counter;
+  }
+
+private:
+  static constexpr std::uint32_t kMultiplier0 = 0xD2511F53;
+  static constexpr std::uint32_t kMultiplier1 = 0xCD9E8D57;
+  static constexpr std::uint32_t kWeyl0 = 0x9E3779B9;
+  static constexpr std::uint32_t kWeyl1 = 0xBB67AE85;
+
+  std::array<std::uint32_t, 2> key_;
+  std::array<std::uint32_t, 4> counter_;
+  std::array<std::uint32_t, 4> output_{};
+  unsigned index_ = 4;  // 4 means the current block is exhausted
+};
+
+}
+
+#endif  // QUANTDREAMCPP_PHILOX_H
@@ -4,8 +4,10 @@
 
 #ifndef ALPHAVANTAGE_H
 #define ALPHAVANTAGE_H
+#include <map>
 #include <string>
 #include <memory>
+#include <vector>
 #include "IHttpClient.h"
 #include "TimeSeries.h"
 
@@ -19,6 +21,11 @@ namespace AlphaVantage {
         std::string fetchDailyTimeSeries(const std::string& symbol) const;
         std::string fetchWeeklyTimeSeries(const std::string& symbol) const;
         std::string fetchMonthlyTimeSeries(const std::string& symbol) const;
+
+        // Fetch several symbols concurrently, one std::async thread per request, so blocking I/O
+        // never occupies the shared compute pool (symbol -> raw JSON).
+        // The HTTP client must allow concurrent get() calls
+        std::map<std::string, std::string> fetchDailyTimeSeries(const std::vector<std::string>& symbols) const;
      private:
         std::string _apiKey;
         std::shared_ptr<IHttpClient> _httpClient;
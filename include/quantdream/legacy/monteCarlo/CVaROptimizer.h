@@ -0,0 +1,116 @@
+//
+// Created by user on 10/15/26.
+//
+
+#ifndef QUANTDREAMCPP_CVAROPTIMIZER_H
+#define QUANTDREAMCPP_CVAROPTIMIZER_H
+
+#include "engine.h"
+
+#include <memory>
+#include <vector>
+#include <Eigen/Dense>
+
+#if HAS_ORTOOLS
+
+namespace operations_research {
+class MPSolver;
+class MPVariable;
+}
+
+struct CVaRSolution {
+  std::vector<double> weights;
+  double VaR = 0.0;
+  double ES = 0.0;
+  bool optimal = false;
+};
+
+// Rockafellar-Uryasev linear program on a scenario set of per-asset losses:
+//   min  ES = t + 1 / alpha% * sum_k p_k u_k
+//   s.t. u_k >= L_k w - t,  u_k >= 0,  sum_j w_j = 1,  lower <= w <= upper,  group bounds
+// Each scenario is one row with the nonzero losses of its assets, u_k and t, and the ES is
+// an auxiliary variable tied to the objective by a single row, so the constraint matrix has
+// about S (N + 2) nonzeros and the LP stays tractable for S in the hundreds of thousands.
+// Solved with GLOP; the last basis is kept and reused when the problem is solved again, so a
+// sequence of close problems (new bounds, new scenarios of the same size) is warm-started
+class CVaROptimizer {
+public:
+  // losses is (nScenarios x nAssets). probabilities are used as given (likelihood ratios over
+  // n, or the weights of a reduced scenario set); empty means equally likely scenarios
+  CVaROptimizer(Eigen::MatrixXd losses, size_t alpha, std::vector<double> probabilities = {});
+
+  // The engine's last simulation, with the weights of its reduced set or its likelihood ratios
+  // under importance sampling
+  template<typename Scalar>
+  explicit CVaROptimizer(const BasicMonteCarloEngine<Scalar> &mc)
+      : CVaROptimizer(mc.getSimulatedLosses().template cast<double>(), mc.getAlpha(),
+                      scenarioProbabilities_(mc)) {}
+
+  ~CVaROptimizer();
+
+  // Replace the scenarios, keeping every constraint. The previous basis is reused
+  // when the scenario count is unchanged
+  void setScenarios(Eigen::MatrixXd losses, std::vector<double> probabilities = {});
+
+  // Box constraints on the weights (long-only full investment by default). Throws when a
+  // lower bound exceeds its upper bound or the bounds cannot sum to one
+  void setBounds(const std::vector<double> &lower, const std::vector<double> &upper);
+
+  // lower <= sum of the weights of assets <= upper. Throws when lower > upper or the range
+  // cannot be reached within the current box bounds
+  void addGroup(const std::vector<size_t> &assets, double lower, double upper);
+  void clearGroups();
+
+  // Cap the ES contribution of asset j at caps[j] of the portfolio ES (NaN leaves it free).
+  // The Euler contribution w_j E[L_j | tail] is not linear in w, so the LP bounds it by the
+  // stand-alone term w_j ES(L_j), which dominates it: w_j ES(L_j) <= caps[j] ES is a linear,
+  // conservative version of the budget
+  void setBudgetCaps(const std::vector<double> &caps);
+
+  CVaRSolution solve();
+
+  [[nodiscard]] size_t nScenarios() const { return static_cast<size_t>(losses_.rows()); }
+  [[nodiscard]] size_t nAssets() const { return static_cast<size_t>(losses_.cols()); }
+
+private:
+  struct Group {
+    std::vector<size_t> assets;
+    double lower;
+    double upper;
+  };
+
+  Eigen::MatrixXd losses_;
+  Eigen::VectorXd probabilities_;
+  size_t alpha_;
+  std::vector<double> lower_;
+  std::vector<double> upper_;
+  std::vector<Group> groups_;
+  std::vector<double> caps_;
+
+  // Model of the last solve, rebuilt only when its structure changes
+  std::unique_ptr<operations_research::MPSolver> solver_;
+  std::vector<operations_research::MPVariable *> weights_;
+  std::vector<operations_research::MPVariable *> excess_;
+  operations_research::MPVariable *threshold_ = nullptr;
+  operations_research::MPVariable *shortfall_ = nullptr;
+
+  // Basis of the last solve (MPSolver::BasisStatus values), used as the starting basis
+  std::vector<int> variableBasis_;
+  std::vector<int> constraintBasis_;
+
+  void build_();
+
+  template<typename Scalar>
+  static std::vector<double> scenarioProbabilities_(const BasicMonteCarloEngine<Scalar> &mc) {
+    if (!mc.getScenarioWeights().empty()) return mc.getScenarioWeights();
+    const auto &ratios = mc.getLikelihoodRatios();
+    if (!mc.getImportanceSampling() || ratios.empty()) return {};
+    std::vector<double> probabilities(ratios.size());
+    for (size_t k = 0; k < ratios.size(); ++k) probabilities[k] = ratios[k] / static_cast<double>(ratios.size());
+    return probabilities;
+  }
+};
+
+#endif  // HAS_ORTOOLS
+
+#endif  // QUANTDREAMCPP_CVAROPTIMIZER_H
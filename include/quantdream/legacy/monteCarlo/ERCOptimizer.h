@@ -5,17 +5,20 @@
 #ifndef QUANTDREAMCPP_ERCOPTIMIZER_H
 #define QUANTDREAMCPP_ERCOPTIMIZER_H
 
+#include <stop_token>
+#include <utility>
 #include <vector>
 #include "engine.h"
 
-class ERCOptimizer {
+template<typename Scalar = double>
+class BasicERCOptimizer {
 public:
-  ERCOptimizer(MonteCarloEngine& mc,
-               size_t nAssets,
-               size_t nMaxIterations,
-               SimulationMethod simMethod,
-               double param1,
-               double param2);
+  BasicERCOptimizer(BasicMonteCarloEngine<Scalar>& mc,
+                    size_t nAssets,
+                    size_t nMaxIterations,
+                    SimulationMethod simMethod,
+                    double param1,
+                    double param2);
 
   std::vector<double> optimize(
     double tol = 1e-4,            // relative tolerance on RC dispersion (vs ES)
@@ -23,15 +26,82 @@ public:
     double damping = 0.5,         // 0<damping<=1 (1=no damping). 0.3–0.7 helps stability
     bool verbose = true) const;   // print progress
 
+  // Common random numbers: simulate once, then re-evaluate the risk contributions of each
+  // new weight vector on that scenario set (likelihood-ratio reweighted for the tilted
+  // methods). Off by default: the fixed-point solver then resimulates at every iteration, as
+  // it always has, and existing callers keep their results
+  void setCommonRandomNumbers(const bool enabled) { commonRandomNumbers_ = enabled; }
+
+  // Anderson acceleration of the damped multiplicative map, mixing the last `depth` iterates
+  // (0 disables it). When an accelerated step increases the contribution dispersion, the
+  // history is dropped and the plain damped step is taken instead. The fixed point is unchanged
+  void setAndersonDepth(const size_t depth) { andersonDepth_ = depth; }
+  [[nodiscard]] size_t getAndersonDepth() const { return andersonDepth_; }
+
+  // Starting point of every solver, e.g. mc.solveCovarianceRiskParity(). Empty (the
+  // default) starts from equal weights
+  void setInitialWeights(const std::vector<double> &weights);
+
+  // Risk budgets: the target share of the ES of each asset, normalised to sum to one. Empty
+  // (the default) is the equal risk contribution. Every solver targets rc_i = b_i ES
+  void setRiskBudgets(const std::vector<double> &budgets);
+  [[nodiscard]] const std::vector<double> &getRiskBudgets() const { return riskBudgets_; }
+
+  // Checked before every iteration: once a stop is requested, optimize() returns the current weights
+  void setStopToken(std::stop_token stop) { stop_ = std::move(stop); }
+
+  // Newton and coordinate descent simulate once at equal weights, then solve on those scenarios:
+  //   min_{y > 0} ES(y) - sum_i b_i log y_i,   w = y / sum(y)
+  // whose optimality conditions y_i dES/dy_i = b_i are the budgeted contributions. The sample ES
+  // is piecewise linear, so it is smoothed in its Rockafellar-Uryasev form (softplus of
+  // width mu) and mu is shrunk towards zero with warm starts. Each iteration counts against
+  // nMaxIterations; tol and eps_rc apply to the final check on the unsmoothed contributions.
+  // Those jump as scenarios enter or leave the tail, so a tol finer than a small tail allows
+  // (about 4e-3 with a tail of 50 paths, 5e-4 with 250) is not met
+  //
+  // StochasticApproximation applies the damped multiplicative update on fresh batches of paths.
+  // The first batch is nSimulations / 16; a batch doubles whenever the contribution dispersion
+  // falls below twice the relative standard error of the ES, so that it is no longer measurable,
+  // up to the full nSimulations. Iterates at the current batch size are averaged
+  // (Polyak-Ruppert), and the average is returned once the dispersion at full size meets tol or,
+  // since a fresh batch cannot resolve a dispersion below its own noise, once it falls below
+  // twice the relative standard error and at least four full-size iterates have been averaged.
+  // The engine's nSimulations is restored on return, including when a simulation throws
+  void setSolver(const ERCSolver solver) { solver_ = solver; }
+  [[nodiscard]] ERCSolver getSolver() const { return solver_; }
+
+  // Iterations run by the last optimize(), counted against nMaxIterations
+  [[nodiscard]] size_t getIterations() const { return iterations_; }
 
 private:
-  MonteCarloEngine& mc_;
+  BasicMonteCarloEngine<Scalar>& mc_;
   size_t nAssets_;
   size_t nMaxIterations_;
   SimulationMethod simMethod_;
   double param1_;
   double param2_;
+  bool commonRandomNumbers_ = false;
+  size_t andersonDepth_ = 0;
+  std::stop_token stop_;
+  ERCSolver solver_ = ERCSolver::FixedPoint;
+  mutable size_t iterations_ = 0;
+
+  std::vector<double> initialWeights_;
+  std::vector<double> riskBudgets_;
+
+  // Initial weights, floored away from zero and normalised
+  [[nodiscard]] std::vector<double> startingWeights_() const;
+  // Risk budgets, equal when none were set
+  [[nodiscard]] std::vector<double> budgetShares_() const;
+  // Stochastic approximation on growing batches
+  std::vector<double> optimizeStochastic_(double tol, double eps_rc, double damping, bool verbose) const;
+  // Newton or coordinate descent on one fixed scenario set
+  std::vector<double> optimizeOnScenarios_(double tol, bool verbose) const;
 };
 
+using ERCOptimizer = BasicERCOptimizer<double>;
+
+extern template class BasicERCOptimizer<float>;
+extern template class BasicERCOptimizer<double>;
 
 #endif  // QUANTDREAMCPP_ERCOPTIMIZER_H
@@ -0,0 +1,46 @@
+//
+// Created by user on 10/15/26.
+//
+
+#ifndef QUANTDREAMCPP_ALIASSAMPLER_H
+#define QUANTDREAMCPP_ALIASSAMPLER_H
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+// Walker/Vose alias table over the indices 0..n-1.
+// Construction is O(n), every draw is O(1) and uses a single uniform variate.
+// The table is immutable after construction, so one instance can be shared by
+// all simulation threads as long as each thread brings its own generator.
+class AliasSampler {
+public:
+  AliasSampler() = default;
+
+  // scores are unnormalised, non-negative weights
+  // If they sum to zero (or less) the sampler falls back to the uniform distribution
+  explicit AliasSampler(const std::vector<double> &scores);
+
+  template<class URBG>
+  size_t operator()(URBG &rng) const {
+    // Pick a column uniformly, then either keep it or jump to its alias
+    std::uniform_real_distribution<double> uniform(0.0, static_cast<double>(threshold_.size()));
+    const double u = uniform(rng);
+    size_t column = static_cast<size_t>(u);
+    if (column >= threshold_.size()) column = threshold_.size() - 1;
+    return (u - static_cast<double>(column)) < threshold_[column] ? column : alias_[column];
+  }
+
+  [[nodiscard]] size_t size() const { return threshold_.size(); }
+
+  // Normalised probability of drawing index i
+  [[nodiscard]] double probability(const size_t i) const { return probabilities_[i]; }
+  [[nodiscard]] const std::vector<double> &probabilities() const { return probabilities_; }
+
+private:
+  std::vector<double> threshold_;     // Probability of keeping the column
+  std::vector<size_t> alias_;         // Index returned otherwise
+  std::vector<double> probabilities_;
+};
+
+#endif  // QUANTDREAMCPP_ALIASSAMPLER_H
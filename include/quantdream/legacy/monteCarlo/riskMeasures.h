@@ -4,6 +4,7 @@
 
 #ifndef QUANTDREAMCPP_RISKMEASURES_H
 #define QUANTDREAMCPP_RISKMEASURES_H
+#include <limits>
 #include <vector>
 #include <Eigen/Dense>
 
@@ -14,14 +15,148 @@ enum class RiskMeasure {
   ES
 };
 
+// Row-major returns: one contiguous row of asset returns per time step,
+// so that a block of consecutive time steps is a single contiguous range
+template<typename Scalar>
+using BasicReturnsMatrix = Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+using ReturnsMatrix = BasicReturnsMatrix<double>;
+
+// Per-asset losses of a scenario set: one row per simulation, one column per asset.
+// Stored in the engine's scalar type; every sum over scenarios is accumulated in double
+template<typename Scalar>
+using LossMatrix = Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>;
+
+// Function to reduce one simulated path (nSamples x nAssets returns) to the
+// buy-and-hold loss of each asset: loss_j = 1 - prod_t (1 + return_tj)
+// The product is accumulated one time step at a time, so the result does not
+// depend on the storage order of the path (or on whether it was stored at all).
+// Single precision paths are compounded in double. The earlier colwise().prod() and dot
+// product summed in another order: losses, VaR and ES differ from it at the ulp level, not bit
+// for bit
+template<typename Derived>
+Eigen::RowVectorXd computeAssetLosses(const Eigen::MatrixBase<Derived> &simulatedReturns) {
+  Eigen::RowVectorXd growth = Eigen::RowVectorXd::Ones(simulatedReturns.cols());
+  for (Eigen::Index t = 0; t < simulatedReturns.rows(); ++t) {
+    growth.array() *= simulatedReturns.row(t).template cast<double>().array() + 1.0;
+  }
+
+  return 1.0 - growth.array();
+}
+
 // Function to compute the portfolio risk measure (VaR or ES) for each simulation
-// using the simulated returns and the weights of the assets in the portfolio
-std::vector<double> computePortfolioRiskMeasures(const std::vector<Eigen::MatrixXd> &simulatedReturns,
+// starting from the per-asset losses already reduced with computeAssetLosses()
+// assetLosses has one row per simulation and one column per asset
+// Instantiated for float and double losses
+template<typename Scalar>
+std::vector<double> computePortfolioRiskMeasures(const LossMatrix<Scalar> &assetLosses,
                                              const std::vector<double> &weights,
                                              const size_t &alpha,
                                              const RiskMeasure &measure,
                                              bool plotLosses = false);
 
+// Batched version for K portfolios evaluated on the same scenarios.
+// weights is (nAssets x K), one portfolio per column. Portfolio losses of all K portfolios are
+// one matrix product; each column then gets its own tail selection.
+// Returns a (K x nAssets+1) matrix: row k holds the contributions of portfolio k followed by
+// its portfolio VaR or ES, i.e. what computePortfolioRiskMeasures returns for that portfolio
+template<typename Scalar>
+Eigen::MatrixXd computePortfolioRiskMeasuresBatch(const LossMatrix<Scalar> &assetLosses,
+                                                  const Eigen::MatrixXd &weights,
+                                                  const size_t &alpha,
+                                                  const RiskMeasure &measure);
+
+// Precision of an ES estimate
+struct RiskPrecision {
+  size_t nScenarios = 0;
+  double standardError = std::numeric_limits<double>::quiet_NaN();
+  // Independent, plain-bootstrap scenarios that would give the same standard error
+  double effectiveSampleSize = 0.0;
+};
+
+// ES with its Euler contributions (same layout as computePortfolioRiskMeasures) and its precision.
+// controls, if not empty, holds one zero-mean control variate per scenario: the tail terms
+// w_j L_ij 1{L_i >= VaR} are regressed on it and the fitted part removed, asset by asset, so the
+// contributions still add up to the ES. The standard error is estimated from the ES influence
+// function VaR + (L - VaR)^+ / tailFraction, averaged over consecutive groups of groupSize
+// scenarios: 1 for independent paths, 2 for antithetic pairs, the replicate size for Latin
+// hypercube designs
+template<typename Scalar>
+std::vector<double> computePortfolioESWithPrecision(const LossMatrix<Scalar> &assetLosses,
+                                                    const std::vector<double> &weights,
+                                                    const size_t &alpha,
+                                                    const std::vector<double> &controls,
+                                                    size_t groupSize,
+                                                    RiskPrecision &precision);
+
+// Confidence levels reported by default in a risk surface
+inline const std::vector<double> kDefaultConfidenceLevels = {0.90, 0.95, 0.975, 0.99, 0.995, 0.999};
+
+// VaR and ES of one portfolio at several confidence levels, with the Euler contributions of
+// each asset. Row l of VaR / ES belongs to confidenceLevels[l] and holds the contributions
+// of each asset followed by the portfolio figure, as computePortfolioRiskMeasures returns them
+struct RiskSurface {
+  std::vector<double> confidenceLevels;  // Increasing, each in (0, 1)
+  Eigen::MatrixXd VaR;                   // Size (levels, nAssets + 1)
+  Eigen::MatrixXd ES;                    // Size (levels, nAssets + 1)
+};
+
+// Every (measure x confidence level) cell from one partial ordering of the portfolio losses:
+// the scenarios are split once at the lowest level, only that tail is sorted, and each
+// level's ES is a suffix sum of it. A level c matches alpha = 100 * (1 - c) above
+template<typename Scalar>
+RiskSurface computePortfolioRiskSurface(const LossMatrix<Scalar> &assetLosses,
+                                        const std::vector<double> &weights,
+                                        const std::vector<double> &confidenceLevels = kDefaultConfidenceLevels);
+
+// Weighted version for scenarios that are not equally likely (e.g. likelihood ratios of a
+// reweighted or importance-sampled scenario set). scenarioWeights need not be normalised.
+// The tail holds the largest portfolio losses until their weight reaches alpha% of the total,
+// so equal weights reproduce the unweighted estimator
+template<typename Scalar>
+std::vector<double> computeWeightedPortfolioRiskMeasures(const LossMatrix<Scalar> &assetLosses,
+                                                         const std::vector<double> &weights,
+                                                         const std::vector<double> &scenarioWeights,
+                                                         const size_t &alpha,
+                                                         const RiskMeasure &measure);
+
+// Importance-sampling estimator for scenarios drawn from a proposal q instead of the target p,
+// each carrying its exact likelihood ratio p / q (mean one under q, so not normalised away).
+// The tail is the largest portfolio losses up to a ratio mass of alpha% of n, the last one
+// counted fractionally, and the ES divides by that mass rather than by the ratios seen, so the
+// tail probability and tail loss are unbiased estimates under p. Unit ratios reproduce the
+// unweighted estimator whenever alpha% of n is a whole number
+template<typename Scalar>
+std::vector<double> computeImportanceSampledRiskMeasures(const LossMatrix<Scalar> &assetLosses,
+                                                         const std::vector<double> &weights,
+                                                         const std::vector<double> &likelihoodRatios,
+                                                         const size_t &alpha,
+                                                         const RiskMeasure &measure);
+
+// Risk surface of an importance-sampled scenario set: every level is the estimator above with
+// alpha = 100 * (1 - c), from one sort of the portfolio losses and one walk down its tail
+template<typename Scalar>
+RiskSurface computeImportanceSampledRiskSurface(const LossMatrix<Scalar> &assetLosses,
+                                                const std::vector<double> &weights,
+                                                const std::vector<double> &likelihoodRatios,
+                                                const std::vector<double> &confidenceLevels = kDefaultConfidenceLevels);
+
+// Function to compute the portfolio risk measure (VaR or ES) for each simulation
+// using the simulated returns and the weights of the assets in the portfolio
+template<typename Matrix>
+std::vector<double> computePortfolioRiskMeasures(const std::vector<Matrix> &simulatedReturns,
+                                             const std::vector<double> &weights,
+                                             const size_t &alpha,
+                                             const RiskMeasure &measure,
+                                             bool plotLosses = false) {
+  // Reduce each simulation to the losses of each asset
+  Eigen::MatrixXd assetLosses(simulatedReturns.size(), weights.size());
+  for (size_t i = 0; i < simulatedReturns.size(); i++) {
+    assetLosses.row(static_cast<Eigen::Index>(i)) = computeAssetLosses(simulatedReturns[i]);
+  }
+
+  return computePortfolioRiskMeasures(assetLosses, weights, alpha, measure, plotLosses);
+}
+
 // Function to compute the Value at Risk (VaR)  and Expected Shortfall (ES)
 // at a given confidence level alpha
 /*
@@ -0,0 +1,91 @@
+//
+// Created by user on 10/15/26.
+//
+
+#ifndef QUANTDREAMCPP_ROLLINGBACKTEST_H
+#define QUANTDREAMCPP_ROLLINGBACKTEST_H
+
+#include "ERCOptimizer.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+struct RollingBacktestOptions {
+  std::string category = "Close";
+  size_t nSimulations = 1000;
+  size_t nSamples = 250;
+  size_t blockSize = 5;
+  size_t alpha = 5;
+  SimulationMethod method = SimulationMethod::Vanilla;
+  double param1 = 10.0;
+  double param2 = 0.0;
+  ERCSolver solver = ERCSolver::FixedPoint;
+  size_t maxIterations = 50;
+  double tol = 1e-3;
+  double eps_rc = 1e-10;
+  double damping = 0.5;
+  bool commonRandomNumbers = false;  // Solve each date on one scenario set, see setCommonRandomNumbers()
+  size_t minHistory = 250;  // Returns needed before the first rebalance; earlier dates are skipped
+  size_t nChains = 1;       // Warm-start chains run in parallel, each over a contiguous run of dates
+  size_t nThreads = 0;      // Chunks of every simulation on the shared pool (0: hardware concurrency)
+  size_t seed = 42;         // Date k of the grid is simulated with seed + k
+};
+
+struct RollingRebalance {
+  std::string date;
+  std::vector<double> weights;
+  double ES = 0.0;          // Portfolio ES at the weights, on the scenarios of the final iteration
+  size_t nReturns = 0;      // Length of the returns window
+  bool warmStarted = false; // From the previous date's weights, or cold from covariance risk parity
+  size_t iterations = 0;    // Solver iterations to reach the weights
+};
+
+// Risk-budgeting backtest over a grid of rebalance dates. Each date solves the ES risk budgets on
+// the returns up to and including it. Within a chain the engine is built once, its returns window
+// is extended date by date with extendData(), and every solve starts from the weights of the
+// previous date. The first date of a chain starts from the budgeted covariance risk parity.
+// With nChains > 1 the grid is cut into contiguous runs solved in parallel: warm starts are
+// lost only at the nChains - 1 cuts, and since each date has its own seed the results do not
+// depend on the thread count. Chains and simulations run as tasks of the shared
+// qd::parallel::ThreadPool, so the nested parallelism never exceeds the pool size
+template<typename Scalar = double>
+class BasicRollingBacktest {
+public:
+  explicit BasicRollingBacktest(YFData data, RollingBacktestOptions options = {});
+
+  // Same budgets at every date (positive, normalised; empty means equal risk contributions)
+  void setRiskBudgets(const std::vector<double> &budgets);
+  // Budgets from a date onwards: each rebalance uses the entry with the latest date not after
+  // it, or the budgets of setRiskBudgets() before the first entry
+  void setRiskBudgetSchedule(std::map<std::string, std::vector<double>> schedule);
+
+  // One result per date with at least minHistory returns, in date order
+  std::vector<RollingRebalance> run(const std::vector<std::string> &dates) const;
+
+  // Last date of every calendar month present in the data (dates as YYYY-MM-DD)
+  [[nodiscard]] std::vector<std::string> monthEnds() const;
+
+private:
+  YFData data_;
+  RollingBacktestOptions options_;
+  std::vector<double> budgets_;
+  std::map<std::string, std::vector<double>> schedule_;
+
+  // Budgets in force at a date
+  [[nodiscard]] const std::vector<double> &budgetsAt_(const std::string &date) const;
+  // Dates of the data in (after, upTo]
+  [[nodiscard]] YFData slice_(const std::string &after, const std::string &upTo) const;
+  // Warm-start chain over dates[first, last), the engine simulating in nThreads chunks
+  std::vector<RollingRebalance> runChain_(const std::vector<std::string> &dates,
+                                          size_t first,
+                                          size_t last,
+                                          size_t nThreads) const;
+};
+
+using RollingBacktest = BasicRollingBacktest<double>;
+
+extern template class BasicRollingBacktest<float>;
+extern template class BasicRollingBacktest<double>;
+
+#endif  // QUANTDREAMCPP_ROLLINGBACKTEST_H
@@ -0,0 +1,41 @@
+//
+// Created by user on 10/15/26.
+//
+
+#ifndef QUANTDREAMCPP_SCENARIOREDUCTION_H
+#define QUANTDREAMCPP_SCENARIOREDUCTION_H
+
+#include "riskMeasures.h"
+
+#include <limits>
+#include <vector>
+
+// Weighted subset of a scenario set, with the error it makes on a reference portfolio
+struct ScenarioReduction {
+  std::vector<size_t> scenarios;   // Rows of the original set that are kept
+  std::vector<double> weights;     // Their probabilities, summing to one
+  double VaRError = std::numeric_limits<double>::quiet_NaN();  // Relative error of the reference VaR
+  double ESError = std::numeric_limits<double>::quiet_NaN();   // Relative error of the reference ES
+  // Largest relative ES error over the single-asset portfolios, whose tails are not kept
+  // explicitly: how well the clusters represent directions away from the reference
+  double assetESError = std::numeric_limits<double>::quiet_NaN();
+};
+
+// Compress the (nScenarios x N) per-asset losses to at most nReduced weighted scenarios.
+// The tail of the reference portfolio is kept scenario by scenario, up to a probability mass of
+// twice alpha% (and at most half of nReduced), so its VaR and ES, and those of nearby weights,
+// are preserved. The other scenarios are grouped by k-medoids on their per-asset loss vectors,
+// seeded at quantiles of the reference loss; each medoid carries the mass of its cluster.
+// scenarioMasses are the probabilities of the input scenarios (e.g. likelihood ratios), need not
+// be normalised, and default to equal. Assignments are computed in nThreads chunks on the
+// shared thread pool
+template<typename Scalar>
+ScenarioReduction reduceScenarios(const LossMatrix<Scalar> &assetLosses,
+                                  size_t nReduced,
+                                  const std::vector<double> &referenceWeights,
+                                  size_t alpha,
+                                  const std::vector<double> &scenarioMasses = {},
+                                  size_t nThreads = 1,
+                                  size_t maxIterations = 10);
+
+#endif  // QUANTDREAMCPP_SCENARIOREDUCTION_H
@@ -0,0 +1,61 @@
+//
+// Created by user on 10/15/26.
+//
+
+#ifndef QUANTDREAMCPP_TAILACCUMULATOR_H
+#define QUANTDREAMCPP_TAILACCUMULATOR_H
+
+#include "riskMeasures.h"
+
+#include <vector>
+#include <Eigen/Dense>
+
+// Streaming VaR / ES over a scenario set that is never held in memory.
+// Scenarios are fed one at a time as (portfolio loss, per-asset losses); only the
+// worst n - floor((1 - alpha%) n) of the nScenarios expected are kept, in a bounded min-heap.
+// Scenarios are ranked by (portfolio loss, scenario index), so the kept tail, and the
+// risk figures computed from it, do not depend on the order in which scenarios arrive.
+// Accumulators filled by different threads over disjoint scenarios can be merged.
+class TailAccumulator {
+public:
+  TailAccumulator(size_t nAssets, size_t nScenarios, size_t alpha);
+
+  // Offer one scenario. Returns false when it is not (or no longer) among the worst seen
+  bool add(size_t scenario, double portfolioLoss, const Eigen::Ref<const Eigen::RowVectorXd> &assetLosses);
+
+  // Absorb the scenarios of another accumulator built with the same dimensions and alpha
+  void merge(const TailAccumulator &other);
+
+  // Same layout as computePortfolioRiskMeasures: the contribution of each asset, scaled by
+  // weights, followed by the portfolio VaR or ES. The tail is sized for the scenarios seen
+  // so far, so the figures are available before all nScenarios have arrived
+  [[nodiscard]] std::vector<double> riskMeasures(const std::vector<double> &weights,
+                                                 RiskMeasure measure) const;
+
+  [[nodiscard]] size_t count() const { return count_; }
+  [[nodiscard]] size_t capacity() const { return capacity_; }
+  [[nodiscard]] size_t size() const { return heap_.size(); }
+  [[nodiscard]] size_t nAssets() const { return nAssets_; }
+
+private:
+  struct Entry {
+    double loss;
+    size_t scenario;
+    Eigen::Index slot;  // Row of rows_ holding the per-asset losses
+  };
+
+  size_t nAssets_;
+  size_t nScenarios_;
+  size_t alpha_;
+  size_t capacity_;
+  size_t count_ = 0;
+  std::vector<Entry> heap_;           // Min-heap: the front is the mildest loss kept
+  BasicReturnsMatrix<double> rows_;   // Size (capacity, nAssets)
+
+  // Tail size of a set of n scenarios at alpha%, as in computePortfolioRiskMeasures
+  [[nodiscard]] size_t tailSize_(size_t n) const;
+  // Keep the scenario if it ranks among the worst capacity_ scenarios offered so far
+  bool insert_(size_t scenario, double portfolioLoss, const Eigen::Ref<const Eigen::RowVectorXd> &assetLosses);
+};
+
+#endif  // QUANTDREAMCPP_TAILACCUMULATOR_H
@@ -5,6 +5,7 @@
 #include "quantdream/legacy/alpha_vantage/AlphaVantage.h"
 #include "quantdream/legacy/alpha_vantage/TimeSeries.h"
 
+#include <future>
 #include <stdexcept>
 #include <string>
 
@@ -41,4 +42,21 @@ namespace AlphaVantage {
                           "&apikey=" + _apiKey;
         return _httpClient->get(url);
     }
+
+    std::map<std::string, std::string> Client::fetchDailyTimeSeries(const std::vector<std::string> &symbols) const {
+        // Requests spend their time waiting on the network: each gets a thread of its own rather
+        // than a worker of the compute pool
+        std::vector<std::future<std::string>> responses;
+        responses.reserve(symbols.size());
+        for (const auto &symbol : symbols) {
+            responses.push_back(std::async(std::launch::async, [this, &symbol]() {
+                return fetchDailyTimeSeries(symbol);
+            }));
+        }
+
+        // get() rethrows a failed request; the other futures still wait for theirs on the way out
+        std::map<std::string, std::string> result;
+        for (size_t i = 0; i < symbols.size(); ++i) result[symbols[i]] = responses[i].get();
+        return result;
+    }
 }
\ No newline at end of file
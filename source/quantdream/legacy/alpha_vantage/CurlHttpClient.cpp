@@ -42,6 +42,8 @@ std::string CurlHttpClient::get(const std::string& url) {
     curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writeCallback);
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, &responseBuffer);
+    // No signals: requests may run concurrently on pool threads
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
 
     // Perform the request
     CURLcode res = curl_easy_perform(curl);
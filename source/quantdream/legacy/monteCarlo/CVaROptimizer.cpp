@@ -0,0 +1,238 @@
+//
+// Created by user on 10/15/26.
+//
+
+#include "quantdream/legacy/monteCarlo/CVaROptimizer.h"
+
+#if HAS_ORTOOLS
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "ortools/linear_solver/linear_solver.h"
+
+using operations_research::MPConstraint;
+using operations_research::MPObjective;
+using operations_research::MPSolver;
+using operations_research::MPVariable;
+
+namespace {
+
+// Slack on the sums of bounds, which carry rounding from the caller's arithmetic
+constexpr double kBoundTolerance = 1e-12;
+
+// Stand-alone ES of one asset under the scenario probabilities: the largest losses
+// up to a probability mass of alpha%, the last one counted fractionally
+double standaloneES(const Eigen::VectorXd &losses, const Eigen::VectorXd &probabilities, const double tailMass) {
+  std::vector<Eigen::Index> order(static_cast<size_t>(losses.size()));
+  std::iota(order.begin(), order.end(), Eigen::Index{0});
+  std::sort(order.begin(), order.end(), [&](Eigen::Index a, Eigen::Index b) { return losses(a) > losses(b); });
+
+  double mass = 0.0;
+  double tail = 0.0;
+  for (const Eigen::Index k : order) {
+    const double take = std::min(probabilities(k), tailMass - mass);
+    if (take <= 0.0) break;
+    mass += take;
+    tail += take * losses(k);
+  }
+  return tail / tailMass;
+}
+
+}  // namespace
+
+CVaROptimizer::CVaROptimizer(Eigen::MatrixXd losses, const size_t alpha, std::vector<double> probabilities)
+    : alpha_(alpha) {
+  if (alpha == 0 || alpha >= 100) {
+    throw std::runtime_error("Alpha must be between 1 and 99!");
+  }
+  setScenarios(std::move(losses), std::move(probabilities));
+  lower_.assign(nAssets(), 0.0);
+  upper_.assign(nAssets(), 1.0);
+}
+
+CVaROptimizer::~CVaROptimizer() = default;
+
+void CVaROptimizer::setScenarios(Eigen::MatrixXd losses, std::vector<double> probabilities) {
+  if (losses.rows() == 0 || losses.cols() == 0) {
+    throw std::runtime_error("No scenarios to optimise on!");
+  }
+  if (!lower_.empty() && static_cast<size_t>(losses.cols()) != lower_.size()) {
+    throw std::runtime_error("New scenarios have a different number of assets!");
+  }
+  if (probabilities.empty()) {
+    probabilities.assign(static_cast<size_t>(losses.rows()), 1.0 / static_cast<double>(losses.rows()));
+  }
+  if (probabilities.size() != static_cast<size_t>(losses.rows())) {
+    throw std::runtime_error("Scenario probabilities and losses have different number of scenarios!");
+  }
+  for (const double p : probabilities) {
+    if (p < 0.0) throw std::runtime_error("Scenario probabilities must be non-negative!");
+  }
+
+  losses_ = std::move(losses);
+  probabilities_ = Eigen::Map<const Eigen::VectorXd>(probabilities.data(), static_cast<Eigen::Index>(probabilities.size()));
+  solver_.reset();
+}
+
+void CVaROptimizer::setBounds(const std::vector<double> &lower, const std::vector<double> &upper) {
+  if (lower.size() != nAssets() || upper.size() != nAssets()) {
+    throw std::runtime_error("Bounds and scenarios have different number of assets!");
+  }
+  for (size_t j = 0; j < nAssets(); ++j) {
+    if (lower[j] > upper[j]) throw std::runtime_error("Lower bound above upper bound!");
+  }
+  // The weights sum to one: bounds that cannot meet it leave no feasible portfolio
+  if (std::accumulate(lower.begin(), lower.end(), 0.0) > 1.0 + kBoundTolerance ||
+      std::accumulate(upper.begin(), upper.end(), 0.0) < 1.0 - kBoundTolerance) {
+    throw std::runtime_error("Bounds cannot sum to one!");
+  }
+  lower_ = lower;
+  upper_ = upper;
+  // Bounds change in place: GLOP restarts from the basis it already holds
+  if (solver_) {
+    for (size_t j = 0; j < nAssets(); ++j) weights_[j]->SetBounds(lower_[j], upper_[j]);
+  }
+}
+
+void CVaROptimizer::addGroup(const std::vector<size_t> &assets, const double lower, const double upper) {
+  for (const size_t j : assets) {
+    if (j >= nAssets()) throw std::runtime_error("Group asset index out of range!");
+  }
+  if (lower > upper) throw std::runtime_error("Group lower bound above upper bound!");
+  // Range the group can reach within the box bounds
+  double reachLower = 0.0;
+  double reachUpper = 0.0;
+  for (const size_t j : assets) {
+    reachLower += lower_[j];
+    reachUpper += upper_[j];
+  }
+  if (lower > reachUpper + kBoundTolerance || upper < reachLower - kBoundTolerance) {
+    throw std::runtime_error("Group bounds cannot be met within the asset bounds!");
+  }
+  groups_.push_back({assets, lower, upper});
+  solver_.reset();
+}
+
+void CVaROptimizer::clearGroups() {
+  groups_.clear();
+  solver_.reset();
+}
+
+void CVaROptimizer::setBudgetCaps(const std::vector<double> &caps) {
+  if (!caps.empty() && caps.size() != nAssets()) {
+    throw std::runtime_error("Budget caps and scenarios have different number of assets!");
+  }
+  caps_ = caps;
+  solver_.reset();
+}
+
+void CVaROptimizer::build_() {
+  const auto nS = static_cast<Eigen::Index>(nScenarios());
+  const size_t N = nAssets();
+  const double tailMass = static_cast<double>(alpha_) / 100.0;
+
+  solver_ = std::make_unique<MPSolver>("cvar", MPSolver::GLOP_LINEAR_PROGRAMMING);
+  const double infinity = solver_->infinity();
+
+  weights_.resize(N);
+  for (size_t j = 0; j < N; ++j) {
+    weights_[j] = solver_->MakeNumVar(lower_[j], upper_[j], "w" + std::to_string(j));
+  }
+  threshold_ = solver_->MakeNumVar(-infinity, infinity, "t");
+  shortfall_ = solver_->MakeNumVar(-infinity, infinity, "es");
+  excess_.resize(static_cast<size_t>(nS));
+  for (Eigen::Index k = 0; k < nS; ++k) {
+    excess_[static_cast<size_t>(k)] = solver_->MakeNumVar(0.0, infinity, "u" + std::to_string(k));
+  }
+
+  // u_k + t - L_k w >= 0, one sparse row per scenario
+  for (Eigen::Index k = 0; k < nS; ++k) {
+    MPConstraint *row = solver_->MakeRowConstraint(0.0, infinity);
+    row->SetCoefficient(excess_[static_cast<size_t>(k)], 1.0);
+    row->SetCoefficient(threshold_, 1.0);
+    for (size_t j = 0; j < N; ++j) {
+      const double loss = losses_(k, static_cast<Eigen::Index>(j));
+      if (loss != 0.0) row->SetCoefficient(weights_[j], -loss);
+    }
+  }
+
+  // es = t + 1 / alpha% * sum_k p_k u_k
+  MPConstraint *definition = solver_->MakeRowConstraint(0.0, 0.0);
+  definition->SetCoefficient(shortfall_, 1.0);
+  definition->SetCoefficient(threshold_, -1.0);
+  for (Eigen::Index k = 0; k < nS; ++k) {
+    if (probabilities_(k) > 0.0) {
+      definition->SetCoefficient(excess_[static_cast<size_t>(k)], -probabilities_(k) / tailMass);
+    }
+  }
+
+  MPConstraint *budget = solver_->MakeRowConstraint(1.0, 1.0);
+  for (size_t j = 0; j < N; ++j) budget->SetCoefficient(weights_[j], 1.0);
+
+  for (const auto &group : groups_) {
+    MPConstraint *row = solver_->MakeRowConstraint(group.lower, group.upper);
+    for (const size_t j : group.assets) row->SetCoefficient(weights_[j], 1.0);
+  }
+
+  // w_j ES(L_j) - cap_j es <= 0
+  for (size_t j = 0; j < caps_.size(); ++j) {
+    if (std::isnan(caps_[j])) continue;
+    const double es = standaloneES(losses_.col(static_cast<Eigen::Index>(j)), probabilities_, tailMass);
+    MPConstraint *row = solver_->MakeRowConstraint(-infinity, 0.0);
+    row->SetCoefficient(weights_[j], es);
+    row->SetCoefficient(shortfall_, -caps_[j]);
+  }
+
+  MPObjective *objective = solver_->MutableObjective();
+  objective->SetCoefficient(shortfall_, 1.0);
+  objective->SetMinimization();
+
+  // Same dimensions as the last model: start from its basis
+  if (variableBasis_.size() == static_cast<size_t>(solver_->NumVariables()) &&
+      constraintBasis_.size() == static_cast<size_t>(solver_->NumConstraints())) {
+    std::vector<MPSolver::BasisStatus> variables(variableBasis_.size());
+    std::vector<MPSolver::BasisStatus> constraints(constraintBasis_.size());
+    std::transform(variableBasis_.begin(), variableBasis_.end(), variables.begin(),
+                   [](int s) { return static_cast<MPSolver::BasisStatus>(s); });
+    std::transform(constraintBasis_.begin(), constraintBasis_.end(), constraints.begin(),
+                   [](int s) { return static_cast<MPSolver::BasisStatus>(s); });
+    solver_->SetStartingLpBasis(variables, constraints);
+  }
+}
+
+CVaRSolution CVaROptimizer::solve() {
+  if (!solver_) build_();
+
+  const MPSolver::ResultStatus status = solver_->Solve();
+
+  CVaRSolution solution;
+  solution.optimal = status == MPSolver::OPTIMAL;
+  if (status != MPSolver::OPTIMAL && status != MPSolver::FEASIBLE) {
+    if (status == MPSolver::INFEASIBLE) {
+      throw std::runtime_error("CVaR program is infeasible under the given constraints!");
+    }
+    throw std::runtime_error("CVaR program could not be solved!");
+  }
+
+  solution.weights.resize(nAssets());
+  for (size_t j = 0; j < nAssets(); ++j) solution.weights[j] = weights_[j]->solution_value();
+  solution.VaR = threshold_->solution_value();
+  solution.ES = shortfall_->solution_value();
+
+  variableBasis_.clear();
+  constraintBasis_.clear();
+  for (const MPVariable *variable : solver_->variables()) {
+    variableBasis_.push_back(static_cast<int>(variable->basis_status()));
+  }
+  for (const MPConstraint *constraint : solver_->constraints()) {
+    constraintBasis_.push_back(static_cast<int>(constraint->basis_status()));
+  }
+  return solution;
+}
+
+#endif  // HAS_ORTOOLS
@@ -4,18 +4,122 @@
 
 #include "quantdream/legacy/monteCarlo/ERCOptimizer.h"
 
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
 #include <memory>
 #include <vector>
 #include <iostream>
 #include <numeric>
 #include <stdexcept>
 
-ERCOptimizer::ERCOptimizer(MonteCarloEngine &mc,
-                           const size_t nAssets,
-                           const size_t nMaxIterations,
-                           SimulationMethod simMethod,
-                           double param1,
-                           double param2)
+namespace {
+
+// Smoothing widths of the ES, relative to the spread of the portfolio losses
+constexpr double kInitialSmoothing = 1e-1;
+constexpr double kFinalSmoothing = 1e-4;
+constexpr double kSmoothingDecay = 1e-1;
+// Newton decrement (or coordinate gradient) below which a smoothing stage is solved
+constexpr double kStageTolerance = 1e-10;
+
+// Stochastic approximation: first batch as a fraction of nSimulations, and the dispersion, in
+// relative standard errors of the ES, below which the batch doubles
+constexpr size_t kInitialBatchFraction = 16;
+constexpr size_t kMinBatch = 256;
+constexpr double kNoiseRatio = 2.0;
+// Full-size iterates averaged before a dispersion lost in the noise may stop the solver
+constexpr size_t kMinAveraged = 4;
+
+// Smoothed Rockafellar-Uryasev form of the ES risk-budgeting program on fixed scenarios:
+//   f(y, t) = t + (1 / a) sum_k p_k s(L_k y - t) - sum_i b_i log y_i,
+//   s(x) = mu log(1 + exp(x / mu))
+// with L the (scenarios x assets) losses, p the scenario probabilities, b the risk budgets
+// and a the tail probability. Portfolio losses z = L y are kept by the solvers and passed in
+class SmoothedBudgeting {
+public:
+  SmoothedBudgeting(Eigen::MatrixXd losses, const Eigen::VectorXd &probabilities, const double tail,
+                    Eigen::VectorXd budgets)
+      : losses_(std::move(losses)), scaled_(probabilities / tail), budgets_(std::move(budgets)) {}
+
+  void setSmoothing(const double mu) { mu_ = mu; }
+  [[nodiscard]] const Eigen::MatrixXd &losses() const { return losses_; }
+  [[nodiscard]] const Eigen::VectorXd &budgets() const { return budgets_; }
+
+  [[nodiscard]] double value(const Eigen::VectorXd &y, const Eigen::VectorXd &z, const double t) const {
+    double f = t - budgets_.dot(y.array().log().matrix());
+    for (Eigen::Index k = 0; k < z.size(); ++k) {
+      const double u = (z(k) - t) / mu_;
+      f += scaled_(k) * mu_ * (std::max(u, 0.0) + std::log1p(std::exp(-std::abs(u))));
+    }
+    return f;
+  }
+
+  // First and second derivatives of the smoothing term, times p_k / a, for every scenario
+  void weights(const Eigen::VectorXd &z, const double t, Eigen::VectorXd &first, Eigen::VectorXd &second) const {
+    first.resize(z.size());
+    second.resize(z.size());
+    for (Eigen::Index k = 0; k < z.size(); ++k) {
+      const double u = (z(k) - t) / mu_;
+      const double sigma = u >= 0.0 ? 1.0 / (1.0 + std::exp(-u)) : std::exp(u) / (1.0 + std::exp(u));
+      first(k) = scaled_(k) * sigma;
+      second(k) = scaled_(k) * sigma * (1.0 - sigma) / mu_;
+    }
+  }
+
+  // Minimiser in t of f(y, t) for the given z: the root of 1 - sum_k (p_k / a) s'(z_k - t),
+  // increasing in t, by safeguarded Newton from the previous threshold
+  [[nodiscard]] double optimalThreshold(const Eigen::VectorXd &z, double t) const {
+    double lo = z.minCoeff() - 50.0 * mu_;
+    double hi = z.maxCoeff() + 50.0 * mu_;
+    Eigen::VectorXd first;
+    Eigen::VectorXd second;
+    for (int k = 0; k < 100; ++k) {
+      weights(z, t, first, second);
+      const double h = 1.0 - first.sum();
+      if (std::abs(h) < 1e-13) break;
+      if (h > 0.0) {
+        hi = t;
+      } else {
+        lo = t;
+      }
+
+      const double slope = second.sum();
+      const double next = slope > 0.0 ? t - h / slope : 0.5 * (lo + hi);
+      t = next > lo && next < hi ? next : 0.5 * (lo + hi);
+    }
+    return t;
+  }
+
+private:
+  Eigen::MatrixXd losses_;
+  Eigen::VectorXd scaled_;
+  Eigen::VectorXd budgets_;
+  double mu_ = 1.0;
+};
+
+// Smallest t with a probability mass of at most a above it: the VaR of z
+double weightedQuantile(const Eigen::VectorXd &z, const Eigen::VectorXd &probabilities, const double tail) {
+  std::vector<Eigen::Index> order(static_cast<size_t>(z.size()));
+  std::iota(order.begin(), order.end(), Eigen::Index{0});
+  std::sort(order.begin(), order.end(), [&](Eigen::Index a, Eigen::Index b) { return z(a) > z(b); });
+
+  double mass = 0.0;
+  for (const Eigen::Index k : order) {
+    mass += probabilities(k);
+    if (mass >= tail) return z(k);
+  }
+  return z(order.back());
+}
+
+}  // namespace
+
+template<typename Scalar>
+BasicERCOptimizer<Scalar>::BasicERCOptimizer(BasicMonteCarloEngine<Scalar> &mc,
+                                             const size_t nAssets,
+                                             const size_t nMaxIterations,
+                                             SimulationMethod simMethod,
+                                             double param1,
+                                             double param2)
     : mc_(mc),
       nAssets_(nAssets),
       nMaxIterations_(nMaxIterations),
@@ -23,19 +127,49 @@ ERCOptimizer::ERCOptimizer(MonteCarloEngine &mc,
       param1_(param1),
       param2_(param2) {}
 
-std::vector<double> ERCOptimizer::optimize(
+template<typename Scalar>
+std::vector<double> BasicERCOptimizer<Scalar>::optimize(
   // hyperparameters for the multiplicative update
   const double tol,       // relative tolerance on RC dispersion (vs ES)
   const double eps_rc,    // floor to avoid division by ~0 and handle negatives
   const double damping,   // 0<damping<=1 (1=no damping). 0.3–0.7 helps stability
   const bool verbose      // print progress
 ) const {
-    // --- initialization: start from equal weights ---
-    std::vector<double> w(nAssets_, 1.0 / static_cast<double>(nAssets_));
+    iterations_ = 0;
+    if (solver_ == ERCSolver::StochasticApproximation) return optimizeStochastic_(tol, eps_rc, damping, verbose);
+    if (solver_ != ERCSolver::FixedPoint) return optimizeOnScenarios_(tol, verbose);
+
+    // --- initialization: equal weights, or the warm start ---
+    std::vector<double> w = startingWeights_();
+    const std::vector<double> budgets = budgetShares_();
+
+    // --- common random numbers: one scenario set for every iteration ---
+    // (a run that keeps only its tail cannot be re-evaluated at other weights)
+    const bool reuseScenarios =
+        commonRandomNumbers_ && mc_.getScenarioStorage() != ScenarioStorage::Tail;
+    if (reuseScenarios) {
+        mc_.setWeights(w);
+        mc_.runSimulation(simMethod_, param1_, param2_);
+    }
 
 
+    // --- Anderson acceleration state: differences of residuals f = G(w) - w and of images G(w) ---
+    std::vector<Eigen::VectorXd> residualSteps;
+    std::vector<Eigen::VectorXd> imageSteps;
+    Eigen::VectorXd lastResidual;
+    Eigen::VectorXd lastImage;
+    Eigen::VectorXd dampedStep;     // The plain damped step an accelerated one replaced
+    bool accelerated = false;
+    double previousDeviation = 0.0;
 
     for (size_t iter = 0; iter < nMaxIterations_; ++iter) {
+    // --- cancellation ---
+    if (stop_.stop_requested()) {
+        if (verbose) std::cout << "\nERC stopped on request after " << iter << " iterations\n";
+        break;
+    }
+    iterations_ = iter + 1;
+
     // --- progress bar (always shown) ---
     double progress = (100.0 * (iter + 1)) / static_cast<double>(nMaxIterations_);
     int barWidth = 50; // characters in the bar
@@ -50,24 +184,24 @@ std::vector<double> ERCOptimizer::optimize(
     std::cout << "] " << int(progress) << " %\r";
     std::cout.flush();
 
-    // --- resimulate scenarios ---
+    // --- resimulate scenarios (or reuse the common ones) ---
     mc_.setWeights(w);
-    mc_.runSimulation(simMethod_, param1_, param2_);
+    if (!reuseScenarios) mc_.runSimulation(simMethod_, param1_, param2_);
 
     // --- compute RCs and ES ---
-    std::vector<double> rc = mc_.computeRiskContributions(RiskMeasure::ES);
+    std::vector<double> rc = reuseScenarios
+                                 ? mc_.reevaluateRiskContributions(RiskMeasure::ES)
+                                 : mc_.computeRiskContributions(RiskMeasure::ES);
     if (rc.size() != nAssets_) {
         throw std::runtime_error("ERCOptimizer: RC size mismatch (expected nAssets).");
     }
     double ES = mc_.getPortfolioLoss();
     if (!(ES >= 0.0)) ES = std::abs(ES);
 
-    const double target = (nAssets_ > 0 ? ES / static_cast<double>(nAssets_) : 0.0);
-
-    // max relative deviation
+    // max relative deviation from the targets b_i * ES
     double max_dev = 0.0;
     for (size_t i = 0; i < nAssets_; ++i) {
-        max_dev = std::max(max_dev, std::abs(rc[i] - target));
+        max_dev = std::max(max_dev, std::abs(rc[i] - budgets[i] * ES));
     }
     const double rel_dev = (ES > 0.0 ? max_dev / ES : max_dev);
 
@@ -75,7 +209,6 @@ std::vector<double> ERCOptimizer::optimize(
     if (verbose) {
         std::cout << "\nIter " << iter
                   << " | ES=" << ES
-                  << " | targetRC=" << target
                   << " | maxDev/ES=" << rel_dev
                   << "\nRC: ";
         for (double rci : rc) std::cout << rci << " ";
@@ -95,11 +228,23 @@ std::vector<double> ERCOptimizer::optimize(
         break;
     }
 
+    // --- a rejected Anderson step: take the damped step it replaced instead ---
+    if (accelerated && rel_dev > previousDeviation) {
+        for (size_t i = 0; i < nAssets_; ++i) w[i] = dampedStep(static_cast<Eigen::Index>(i));
+        residualSteps.clear();
+        imageSteps.clear();
+        lastResidual.resize(0);
+        accelerated = false;
+        if (verbose) std::cout << "Anderson step rejected, history reset\n";
+        continue;
+    }
+
     // --- multiplicative update ---
+    const std::vector<double> w_prev = w;
     std::vector<double> w_prop(nAssets_);
     for (size_t i = 0; i < nAssets_; ++i) {
         const double denom = std::max(rc[i], eps_rc);
-        w_prop[i] = w[i] * (target / denom);
+        w_prop[i] = w[i] * (budgets[i] * ES / denom);
         if (w_prop[i] < 0.0) w_prop[i] = 0.0;
     }
 
@@ -120,6 +265,47 @@ std::vector<double> ERCOptimizer::optimize(
     if (sum_after != 0.0) {
         for (double &wi : w) wi /= sum_after;
     }
+
+    // --- Anderson acceleration of the damped map ---
+    if (andersonDepth_ > 0) {
+        const auto n = static_cast<Eigen::Index>(nAssets_);
+        const Eigen::VectorXd image = Eigen::Map<const Eigen::VectorXd>(w.data(), n);
+        const Eigen::VectorXd residual = image - Eigen::Map<const Eigen::VectorXd>(w_prev.data(), n);
+
+        if (lastResidual.size() == n) {
+            residualSteps.push_back(residual - lastResidual);
+            imageSteps.push_back(image - lastImage);
+            if (residualSteps.size() > andersonDepth_) {
+                residualSteps.erase(residualSteps.begin());
+                imageSteps.erase(imageSteps.begin());
+            }
+        }
+        lastResidual = residual;
+        lastImage = image;
+        previousDeviation = rel_dev;
+        accelerated = false;
+
+        if (!residualSteps.empty()) {
+            // w = G(w) - dG gamma, with gamma the least-squares fit of the residual by dF
+            const auto m = static_cast<Eigen::Index>(residualSteps.size());
+            Eigen::MatrixXd dF(n, m);
+            Eigen::MatrixXd dG(n, m);
+            for (Eigen::Index j = 0; j < m; ++j) {
+                dF.col(j) = residualSteps[static_cast<size_t>(j)];
+                dG.col(j) = imageSteps[static_cast<size_t>(j)];
+            }
+            const Eigen::VectorXd gamma = dF.colPivHouseholderQr().solve(residual);
+            Eigen::VectorXd candidate = (image - dG * gamma).cwiseMax(0.0);
+
+            const double total = candidate.sum();
+            if (candidate.allFinite() && total > 0.0) {
+                candidate /= total;
+                for (size_t i = 0; i < nAssets_; ++i) w[i] = candidate(static_cast<Eigen::Index>(i));
+                dampedStep = image;
+                accelerated = true;
+            }
+        }
+    }
 }
 
 // make sure bar ends cleanly
@@ -127,3 +313,309 @@ std::cout << std::endl;
 
     return w;
 }
+
+template<typename Scalar>
+std::vector<double> BasicERCOptimizer<Scalar>::optimizeStochastic_(const double tol,
+                                                                   const double eps_rc,
+                                                                   const double damping,
+                                                                   const bool verbose) const {
+    const size_t fullBatch = mc_.getNumSimulations();
+    size_t batch = std::min(fullBatch, std::max(kMinBatch, fullBatch / kInitialBatchFraction));
+
+    // The caller's simulation count is restored however the solve ends
+    struct RestoreSimulations {
+        BasicMonteCarloEngine<Scalar> &mc;
+        size_t nSimulations;
+        ~RestoreSimulations() { mc.setNumSimulations(nSimulations); }
+    } restore{mc_, fullBatch};
+
+    std::vector<double> w = startingWeights_();
+    const std::vector<double> budgets = budgetShares_();
+    std::vector<double> average(nAssets_, 0.0);
+    size_t averaged = 0;
+
+    for (size_t iter = 0; iter < nMaxIterations_ && !stop_.stop_requested(); ++iter) {
+        iterations_ = iter + 1;
+
+        // --- fresh scenarios of the current batch size ---
+        mc_.setWeights(w);
+        mc_.setNumSimulations(batch);
+        mc_.runSimulation(simMethod_, param1_, param2_);
+        const std::vector<double> rc = mc_.computeRiskContributions(RiskMeasure::ES);
+
+        const double ES = std::abs(mc_.getPortfolioLoss());
+        double max_dev = 0.0;
+        for (size_t i = 0; i < nAssets_; ++i) max_dev = std::max(max_dev, std::abs(rc[i] - budgets[i] * ES));
+        const double rel_dev = (ES > 0.0 ? max_dev / ES : max_dev);
+
+        // Noise level of this batch: the ES standard error, or the tail size when not available
+        double noise = mc_.getRiskPrecision().standardError / ES;
+        if (!std::isfinite(noise)) {
+            noise = 1.0 / std::sqrt(std::max(1.0, static_cast<double>(batch * mc_.getAlpha()) / 100.0));
+        }
+
+        // --- Polyak-Ruppert average of the iterates at this batch size ---
+        for (size_t i = 0; i < nAssets_; ++i) average[i] += w[i];
+        ++averaged;
+
+        if (verbose) {
+            std::cout << "Iter " << iter
+                      << " | batch " << batch
+                      << " | ES=" << ES
+                      << " | maxDev/ES=" << rel_dev
+                      << " | noise=" << noise << "\n";
+        }
+
+        // At full size the dispersion of a fresh batch cannot fall much below its noise: stop once it
+        // meets tol, or once it is lost in the noise and enough iterates have been averaged
+        if (batch == fullBatch &&
+            (rel_dev <= tol || (rel_dev <= kNoiseRatio * noise && averaged >= kMinAveraged))) {
+            break;
+        }
+
+        // --- grow the batch once the dispersion is lost in the noise ---
+        if (batch < fullBatch && rel_dev < kNoiseRatio * noise) {
+            batch = std::min(fullBatch, 2 * batch);
+            std::fill(average.begin(), average.end(), 0.0);
+            averaged = 0;
+        }
+
+        // --- damped multiplicative update, as in the fixed point ---
+        std::vector<double> w_prop(nAssets_);
+        double sum_w = 0.0;
+        for (size_t i = 0; i < nAssets_; ++i) {
+            w_prop[i] = w[i] * (budgets[i] * ES / std::max(rc[i], eps_rc));
+            sum_w += w_prop[i];
+        }
+        for (size_t i = 0; i < nAssets_; ++i) {
+            const double proposal = sum_w > 0.0 ? w_prop[i] / sum_w : 1.0 / static_cast<double>(nAssets_);
+            w[i] = (1.0 - damping) * w[i] + damping * proposal;
+        }
+    }
+    // The average of the iterates is less noisy than the last one
+    if (averaged > 0) {
+        const double total = std::accumulate(average.begin(), average.end(), 0.0);
+        for (size_t i = 0; i < nAssets_; ++i) w[i] = average[i] / total;
+    }
+    mc_.setWeights(w);
+
+    if (verbose) {
+        std::cout << "Final Weights (average of " << averaged << " iterates):";
+        for (double wi : w) std::cout << " " << wi;
+        std::cout << "\n";
+    }
+    return w;
+}
+
+template<typename Scalar>
+void BasicERCOptimizer<Scalar>::setInitialWeights(const std::vector<double> &weights) {
+    if (!weights.empty() && weights.size() != nAssets_) {
+        throw std::runtime_error("ERCOptimizer: initial weights size mismatch (expected nAssets).");
+    }
+    initialWeights_ = weights;
+}
+
+template<typename Scalar>
+void BasicERCOptimizer<Scalar>::setRiskBudgets(const std::vector<double> &budgets) {
+    if (budgets.empty()) {
+        riskBudgets_.clear();
+        return;
+    }
+    if (budgets.size() != nAssets_) {
+        throw std::runtime_error("ERCOptimizer: risk budgets size mismatch (expected nAssets).");
+    }
+
+    double total = 0.0;
+    for (const double b : budgets) {
+        if (!(b > 0.0)) throw std::runtime_error("ERCOptimizer: risk budgets must be positive.");
+        total += b;
+    }
+    riskBudgets_ = budgets;
+    for (double &b : riskBudgets_) b /= total;
+}
+
+template<typename Scalar>
+std::vector<double> BasicERCOptimizer<Scalar>::budgetShares_() const {
+    if (riskBudgets_.empty()) return std::vector<double>(nAssets_, 1.0 / static_cast<double>(nAssets_));
+    return riskBudgets_;
+}
+
+template<typename Scalar>
+std::vector<double> BasicERCOptimizer<Scalar>::startingWeights_() const {
+    if (initialWeights_.empty()) return std::vector<double>(nAssets_, 1.0 / static_cast<double>(nAssets_));
+
+    // The solvers need strictly positive weights summing to one
+    std::vector<double> w(nAssets_);
+    double total = 0.0;
+    for (size_t i = 0; i < nAssets_; ++i) {
+        w[i] = std::max(initialWeights_[i], 1e-8);
+        total += w[i];
+    }
+    for (double &wi : w) wi /= total;
+    return w;
+}
+
+template<typename Scalar>
+std::vector<double> BasicERCOptimizer<Scalar>::optimizeOnScenarios_(const double tol, const bool verbose) const {
+    if (mc_.getScenarioStorage() == ScenarioStorage::Tail) {
+        throw std::runtime_error("ERCOptimizer: Newton and coordinate descent need every loss! Use a scenario "
+                                 "storage other than ScenarioStorage::Tail.");
+    }
+
+    // --- one scenario set, drawn at the initial weights ---
+    std::vector<double> w = startingWeights_();
+    mc_.setWeights(w);
+    mc_.runSimulation(simMethod_, param1_, param2_);
+
+    const Eigen::MatrixXd losses = mc_.getSimulatedLosses().template cast<double>();
+    const auto nScenarios = losses.rows();
+    if (losses.cols() != static_cast<Eigen::Index>(nAssets_)) {
+        throw std::runtime_error("ERCOptimizer: loss matrix size mismatch (expected nAssets columns).");
+    }
+
+    // Scenario probabilities: as drawn, the weights of a reduced set, or the likelihood ratios
+    // of an importance-sampled run
+    Eigen::VectorXd probabilities = Eigen::VectorXd::Constant(nScenarios, 1.0 / static_cast<double>(nScenarios));
+    const std::vector<double> &ratios = mc_.getLikelihoodRatios();
+    const std::vector<double> &scenarioWeights = mc_.getScenarioWeights();
+    if (!scenarioWeights.empty()) {
+        probabilities = Eigen::Map<const Eigen::VectorXd>(scenarioWeights.data(), nScenarios);
+    } else if (mc_.getImportanceSampling() && !ratios.empty()) {
+        probabilities = Eigen::Map<const Eigen::VectorXd>(ratios.data(), nScenarios) / static_cast<double>(nScenarios);
+    }
+    const double tail = static_cast<double>(mc_.getAlpha()) / 100.0;
+    const std::vector<double> shares = budgetShares_();
+    const Eigen::VectorXd budgets = Eigen::Map<const Eigen::VectorXd>(shares.data(), static_cast<Eigen::Index>(nAssets_));
+    SmoothedBudgeting problem(losses, probabilities, tail, budgets);
+
+    // --- start from the initial weights scaled to unit ES, the scale of the solution ---
+    Eigen::VectorXd y = Eigen::Map<const Eigen::VectorXd>(w.data(), static_cast<Eigen::Index>(nAssets_));
+    Eigen::VectorXd z = losses * y;
+    {
+        const double VaR = weightedQuantile(z, probabilities, tail);
+        double ES = 0.0;
+        for (Eigen::Index k = 0; k < nScenarios; ++k) ES += probabilities(k) * std::max(z(k) - VaR, 0.0);
+        ES = VaR + ES / tail;
+        if (ES > 0.0) {
+            y /= ES;
+            z /= ES;
+        }
+    }
+    double t = weightedQuantile(z, probabilities, tail);
+
+    const double mean = z.dot(probabilities);
+    const double spread = std::sqrt(std::max(probabilities.dot((z.array() - mean).square().matrix()), 1e-300));
+
+    Eigen::VectorXd first;
+    Eigen::VectorXd second;
+    size_t iterations = 0;
+    for (double mu = kInitialSmoothing; mu >= kFinalSmoothing * (1.0 - 1e-9); mu *= kSmoothingDecay) {
+        problem.setSmoothing(mu * spread);
+        if (solver_ == ERCSolver::CoordinateDescent) t = problem.optimalThreshold(z, t);
+
+        bool solved = false;
+        while (!solved && iterations < nMaxIterations_ && !stop_.stop_requested()) {
+            ++iterations;
+            problem.weights(z, t, first, second);
+
+            if (solver_ == ERCSolver::Newton) {
+                // --- Newton step on (y, t) ---
+                const auto n = static_cast<Eigen::Index>(nAssets_);
+                Eigen::VectorXd gradient(n + 1);
+                gradient.head(n) = losses.transpose() * first - budgets.cwiseQuotient(y);
+                gradient(n) = 1.0 - first.sum();
+
+                Eigen::MatrixXd hessian(n + 1, n + 1);
+                hessian.topLeftCorner(n, n) = losses.transpose() * second.asDiagonal() * losses;
+                hessian.topLeftCorner(n, n).diagonal() += budgets.cwiseQuotient(y.cwiseAbs2());
+                hessian.col(n).head(n) = -(losses.transpose() * second);
+                hessian.row(n).head(n) = hessian.col(n).head(n).transpose();
+                hessian(n, n) = std::max(second.sum(), 1e-12);
+
+                const Eigen::VectorXd step = hessian.ldlt().solve(-gradient);
+                const double decrement = -gradient.dot(step);
+                if (!(decrement > kStageTolerance)) {
+                    solved = true;
+                    break;
+                }
+
+                // Stay inside y > 0, then backtrack until the decrease is sufficient
+                double length = 1.0;
+                for (Eigen::Index i = 0; i < n; ++i) {
+                    if (step(i) < 0.0) length = std::min(length, -0.99 * y(i) / step(i));
+                }
+                const double f = problem.value(y, z, t);
+                const Eigen::VectorXd dz = losses * step.head(n);
+                for (int k = 0; k < 60; ++k, length *= 0.5) {
+                    const Eigen::VectorXd yNext = y + length * step.head(n);
+                    const Eigen::VectorXd zNext = z + length * dz;
+                    const double tNext = t + length * step(n);
+                    if (problem.value(yNext, zNext, tNext) <= f - 0.25 * length * decrement) {
+                        y = yNext;
+                        z = zNext;
+                        t = tNext;
+                        break;
+                    }
+                }
+            } else {
+                // --- one cyclical sweep over y_1 .. y_n, with t kept at its optimum for y ---
+                // Curvature along y_i of min_t f(y, t), after eliminating t
+                double largest = 0.0;
+                for (size_t i = 0; i < nAssets_; ++i) {
+                    const auto col = static_cast<Eigen::Index>(i);
+                    const double cross = losses.col(col).dot(second);
+                    const double d1 = losses.col(col).dot(first) - budgets(col) / y(col);
+                    const double d2 = losses.col(col).cwiseAbs2().dot(second) - cross * cross / std::max(second.sum(), 1e-300)
+                                      + budgets(col) / (y(col) * y(col));
+                    largest = std::max(largest, std::abs(d1) * y(col));
+
+                    // Damped Newton step (full once close), never more than halving y_i
+                    const double decrement = std::abs(d1) / std::sqrt(d2);
+                    double delta = -d1 / d2 / (decrement > 0.25 ? 1.0 + decrement : 1.0);
+                    delta = std::max(delta, -0.5 * y(col));
+                    y(col) += delta;
+                    z += delta * losses.col(col);
+
+                    t = problem.optimalThreshold(z, t);
+                    problem.weights(z, t, first, second);
+                }
+
+                if (largest < kStageTolerance) solved = true;
+            }
+        }
+
+        if (verbose) {
+            std::cout << "Smoothing " << mu << " | iterations " << iterations
+                      << " | objective " << problem.value(y, z, t) << "\n";
+        }
+    }
+
+    iterations_ = iterations;
+
+    // --- normalise and check the unsmoothed contributions on the same scenarios ---
+    const double total = y.sum();
+    for (size_t i = 0; i < nAssets_; ++i) w[i] = y(static_cast<Eigen::Index>(i)) / total;
+    mc_.setWeights(w);
+    const std::vector<double> rc = mc_.computeRiskContributions(RiskMeasure::ES);
+
+    const double ES = std::abs(mc_.getPortfolioLoss());
+    double max_dev = 0.0;
+    for (size_t i = 0; i < nAssets_; ++i) max_dev = std::max(max_dev, std::abs(rc[i] - shares[i] * ES));
+    const double rel_dev = (ES > 0.0 ? max_dev / ES : max_dev);
+
+    if (verbose) {
+        std::cout << "ERC " << (solver_ == ERCSolver::Newton ? "Newton" : "coordinate descent")
+                  << " | iterations " << iterations
+                  << " | ES=" << ES
+                  << " | maxDev/ES=" << rel_dev
+                  << (rel_dev <= tol ? " (converged)" : "")
+                  << "\nFinal Weights:";
+        for (double wi : w) std::cout << " " << wi;
+        std::cout << "\n";
+    }
+
+    return w;
+}
+
+template class BasicERCOptimizer<float>;
+template class BasicERCOptimizer<double>;
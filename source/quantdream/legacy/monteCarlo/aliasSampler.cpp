@@ -0,0 +1,58 @@
+//
+// Created by user on 10/15/26.
+//
+
+#include "quantdream/legacy/monteCarlo/aliasSampler.h"
+
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+AliasSampler::AliasSampler(const std::vector<double> &scores) {
+  const size_t n = scores.size();
+  if (n == 0) {
+    throw std::runtime_error("AliasSampler: cannot build a table over an empty support!");
+  }
+
+  // Normalise scores into probabilities
+  double Z = std::accumulate(scores.begin(), scores.end(), 0.0);
+  probabilities_.resize(n);
+  for (size_t i = 0; i < n; ++i) {
+    probabilities_[i] = (Z > 0.0) ? scores[i] / Z : 1.0 / static_cast<double>(n);
+  }
+
+  // Vose's method: scale probabilities by n, then pair every under-full column
+  // with an over-full one until all columns hold exactly 1
+  std::vector<double> scaled(n);
+  std::vector<size_t> small, large;
+  small.reserve(n);
+  large.reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    scaled[i] = probabilities_[i] * static_cast<double>(n);
+    (scaled[i] < 1.0 ? small : large).push_back(i);
+  }
+
+  threshold_.assign(n, 1.0);
+  alias_.resize(n);
+  std::iota(alias_.begin(), alias_.end(), size_t{0});
+
+  while (!small.empty() && !large.empty()) {
+    const size_t s = small.back();
+    small.pop_back();
+    const size_t l = large.back();
+
+    threshold_[s] = scaled[s];
+    alias_[s] = l;
+
+    // The large column donates what the small one was missing
+    scaled[l] = (scaled[l] + scaled[s]) - 1.0;
+    if (scaled[l] < 1.0) {
+      large.pop_back();
+      small.push_back(l);
+    }
+  }
+
+  // Whatever is left is full up to rounding error
+  for (const size_t i : small) threshold_[i] = 1.0;
+  for (const size_t i : large) threshold_[i] = 1.0;
+}
@@ -5,15 +5,30 @@
 #include "quantdream/legacy/monteCarlo/engine.h"
 #include "quantdream/legacy/monteCarlo/riskMeasures.h"
 #include "quantdream/legacy/monteCarlo/ERCOptimizer.h"
+#include "quantdream/legacy/monteCarlo/aliasSampler.h"
+#include "quantdream/legacy/monteCarlo/tailAccumulator.h"
+#include "quantdream/core/random/philox.h"
+#include "quantdream/core/parallel/thread_pool.h"
 
 #include <eigen3/Eigen/Dense>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <optional>
 #include <random>
+#include <thread>
 #include <string>
 #include <utility>
 #include <vector>
 #include <stdexcept>
+#include <stop_token>
 #include <iterator>
+#include <limits>
 #include <cmath>
 
 // YFinance Data Structure
@@ -22,18 +37,64 @@ using YFData = std::map<std::string,                      // Date
                         std::map<std::string,             // Ticker
                         double>>>;                        // Value
 
-MonteCarloEngine::MonteCarloEngine(YFData data,
-                                   const size_t &nSimulations,
-                                   const size_t &nSamples,
-                                   const size_t &blockSize,
-                                   const size_t &alpha)
-                                     : marketData_(std::move(data)),
-                                       nSimulations_(nSimulations),
-                                       nSamples_(nSamples),
-                                       alpha_(alpha),
-                                       rng_(std::random_device{}()) {}
-
-void MonteCarloEngine::setInitialWeights_() {
+namespace {
+
+// Historical log-growth of `length` rows read circularly from `start`, from a prefix of size T
+double circularGrowth(const std::vector<double> &prefix, const size_t start, const size_t length) {
+  const size_t rows = prefix.size() - 1;
+  const size_t end = start + length;
+  return static_cast<double>(end / rows) * prefix[rows] + prefix[end % rows] - prefix[start];
+}
+
+// Standard normal quantile, by bisection on the CDF
+double normalQuantile(const double p) {
+  double lo = -40.0;
+  double hi = 40.0;
+  for (int k = 0; k < 100; ++k) {
+    const double mid = 0.5 * (lo + hi);
+    if (0.5 * std::erfc(-mid / std::sqrt(2.0)) < p) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  return 0.5 * (lo + hi);
+}
+
+}  // namespace
+
+template<typename Scalar>
+BasicMonteCarloEngine<Scalar>::BasicMonteCarloEngine(YFData data,
+                                                    const size_t &nSimulations,
+                                                    const size_t &nSamples,
+                                                    const size_t &blockSize,
+                                                    const size_t &alpha)
+                                                      : marketData_(std::move(data)),
+                                                        nSimulations_(nSimulations),
+                                                        nSamples_(nSamples),
+                                                        alpha_(alpha) {
+  seed_ = std::random_device{}();
+  rng_.seed(seed_);
+  setNumThreads(0);
+}
+
+template<typename Scalar>
+void BasicMonteCarloEngine<Scalar>::setNumThreads(const size_t nThreads) {
+  nThreads_ = nThreads > 0 ? nThreads : std::thread::hardware_concurrency();
+  if (nThreads_ == 0) nThreads_ = 1;
+}
+
+template<typename Scalar>
+std::mt19937 BasicMonteCarloEngine<Scalar>::pathGenerator_(const size_t epoch, const size_t path) const {
+  // Mix all 64 bits of seed, epoch and path index so that streams never overlap
+  const auto lo = [](uint64_t v) { return static_cast<uint32_t>(v); };
+  const auto hi = [](uint64_t v) { return static_cast<uint32_t>(v >> 32); };
+  std::seed_seq seq{lo(seed_), hi(seed_), lo(epoch), hi(epoch), lo(path), hi(path)};
+  return std::mt19937(seq);
+}
+
+template<typename Scalar>
+void BasicMonteCarloEngine<Scalar>::setInitialWeights_() {
   // Get the number of assets from the first date
   size_t N = selectedData_.size();
   double weight = 1.0 / static_cast<double>(N);
@@ -42,7 +103,16 @@ void MonteCarloEngine::setInitialWeights_() {
   }
 }
 
-void MonteCarloEngine::setWeights(const std::vector<double> &weightsVector) {
+template<typename Scalar>
+void BasicMonteCarloEngine<Scalar>::setNumSimulations(const size_t nSimulations) {
+  if (nSimulations == 0) {
+    throw std::runtime_error("The number of simulations must be positive!");
+  }
+  nSimulations_ = nSimulations;
+}
+
+template<typename Scalar>
+void BasicMonteCarloEngine<Scalar>::setWeights(const std::vector<double> &weightsVector) {
   if (weightsVector.size() != availableTickers_.size()) {
     throw std::runtime_error("Weights vector size does not match number of available tickers!");
   }
@@ -62,7 +132,8 @@ void MonteCarloEngine::setWeights(const std::vector<double> &weightsVector) {
   weightsVector_ = weightsVector;
 }
 
-void MonteCarloEngine::computeSelectedDataReturns_() {
+template<typename Scalar>
+void BasicMonteCarloEngine<Scalar>::computeSelectedDataReturns_() {
   // Initialize the matrix of returns
   const size_t cols = selectedData_.size();
   const size_t rows = (selectedData_.begin()->second).size() - 1;
@@ -81,15 +152,25 @@ void MonteCarloEngine::computeSelectedDataReturns_() {
     // Compute returns
     for (size_t i = 1; i < values.size(); ++i) {
       const double ret = (values[i] - values[i - 1]) / values[i - 1];
-      selectedDataReturns_(i - 1, j) = ret;
+      selectedDataReturns_(i - 1, j) = static_cast<Scalar>(ret);
       returns.push_back(ret);
       x_ret[i - 1] = i - 1;
     }
     ++j;
   }
+
+  // Prefix sums of log(1 + r): row t holds the log growth of rows [0, t)
+  logGrowthPrefix_ = ReturnsMatrix::Zero(static_cast<Eigen::Index>(rows) + 1,
+                                           static_cast<Eigen::Index>(cols));
+  for (Eigen::Index t = 0; t < static_cast<Eigen::Index>(rows); ++t) {
+    logGrowthPrefix_.row(t + 1) =
+        logGrowthPrefix_.row(t).array()
+        + selectedDataReturns_.row(t).template cast<double>().array().log1p();
+  }
 }
 
-void MonteCarloEngine::selectCategory(const std::string &category) {
+template<typename Scalar>
+void BasicMonteCarloEngine<Scalar>::selectCategory(const std::string &category) {
   if (marketData_.empty()) {
     throw std::runtime_error("Market data is empty! Please check input data before selecting a category.");
   }
@@ -123,6 +204,7 @@ void MonteCarloEngine::selectCategory(const std::string &category) {
         // Save the selected data
         selectedData_[ticker].push_back(value);
       }
+      lastSelectedDate_ = date;
 
     } else {
       // Return error if category not found
@@ -138,7 +220,9 @@ void MonteCarloEngine::selectCategory(const std::string &category) {
 
   if (!selectedData_.empty()) {
     // Compute returns for each ticker
+    selectedCategory_ = category;
     computeSelectedDataReturns_();
+    clearRunState_();
 
     // Set initial weights to 1 / N
     // where N is the number of assets
@@ -148,150 +232,261 @@ void MonteCarloEngine::selectCategory(const std::string &category) {
   }
 }
 
-Eigen::MatrixXd MonteCarloEngine::runSingleSimulationVanilla(const size_t blockSize) {
-  if (selectedDataReturns_.size() == 0) {
-    throw std::runtime_error("No category selected! Please select a category before running simulation."
-                             "Use selectCategory() method.");
-  }
+template<typename Scalar>
+size_t BasicMonteCarloEngine<Scalar>::extendData(const YFData &data) {
+  requireReturns_();
 
-  // Generate uniform distribution
-  const size_t T = selectedDataReturns_.rows() - blockSize;
-  const size_t n_cols = selectedDataReturns_.cols();
-  std::uniform_int_distribution<size_t> distribution(0, T - 1);
+  const size_t first = selectedData_.begin()->second.size();
+  size_t added = 0;
+  for (auto it = data.upper_bound(lastSelectedDate_); it != data.end(); ++it) {
+    const auto &[date, categories] = *it;
+    const auto category = categories.find(selectedCategory_);
+    if (category == categories.end()) {
+      throw std::runtime_error("Category not found in data! Please check the category name.");
+    }
 
-  // Initialize portfolio and assets' losses
-  Eigen::MatrixXd simulatedReturns(nSamples_, n_cols);
-
-  // Extract an index from the distribution
-  // Then Pick the corresponding return from each asset so that cross-correlation is kept
-  for (Eigen::Index row = 0; row < nSamples_ / blockSize + 1; row++) {
-    auto idx = static_cast<Eigen::Index>(distribution(rng_));
-    for (Eigen::Index block = 0; block < blockSize; block++) {
-      if (row * blockSize + block >= nSamples_) break;
-      for (Eigen::Index col = 0; col < n_cols; col++) {
-        simulatedReturns(row * blockSize + block, col) =
-            selectedDataReturns_(idx + block, col);
+    // Every selected ticker needs a price on the date
+    bool complete = true;
+    for (const auto &ticker : availableTickers_) {
+      const auto price = category->second.find(ticker);
+      if (price == category->second.end() || std::isnan(price->second)) {
+        complete = false;
+        break;
       }
     }
-  }
+    if (!complete) continue;
 
-  return simulatedReturns;
-}
+    for (const auto &ticker : availableTickers_) selectedData_[ticker].push_back(category->second.at(ticker));
+    marketData_[date] = categories;
+    lastSelectedDate_ = date;
+    ++added;
+  }
 
-Eigen::MatrixXd MonteCarloEngine::runSingleSimulation(const size_t blockSize, const double lambda) {
-  // Safety: make sure returns have been computed
-  if (selectedDataReturns_.size() == 0) {
-    throw std::runtime_error(
-        "No category selected! Please select a category before running simulation. "
-        "Use selectCategory() method.");
+  if (added > 0) {
+    appendSelectedDataReturns_(first);
+    clearRunState_();
   }
+  return added;
+}
 
-  // Total number of possible starting points for a block
-  // Example: if you have 1000 rows and blockSize=10, you can start at 0..990
-  const size_t T = selectedDataReturns_.rows() - blockSize + 1;
-  const size_t n_cols = selectedDataReturns_.cols();
+template<typename Scalar>
+void BasicMonteCarloEngine<Scalar>::appendSelectedDataReturns_(const size_t first) {
+  const auto cols = static_cast<Eigen::Index>(selectedData_.size());
+  const auto oldRows = selectedDataReturns_.rows();
+  const auto rows = static_cast<Eigen::Index>(selectedData_.begin()->second.size()) - 1;
+  selectedDataReturns_.conservativeResize(rows, cols);
+  logGrowthPrefix_.conservativeResize(rows + 1, cols);
 
-  // If no weights are set, use equal weights across assets
-  std::vector<double> w = weightsVector_;
-  if (w.empty()) {
-    w.assign(n_cols, 1.0 / n_cols);
+  Eigen::Index j = 0;
+  for (const auto &[ticker, values] : selectedData_) {
+    for (size_t i = first; i < values.size(); ++i) {
+      selectedDataReturns_(static_cast<Eigen::Index>(i) - 1, j) =
+          static_cast<Scalar>((values[i] - values[i - 1]) / values[i - 1]);
+    }
+    ++j;
   }
-  Eigen::Map<const Eigen::VectorXd> ew(w.data(), w.size());
-
-  // ---------------------------------------------------------
-  // Step 1: Compute "badness scores" for each block start
-  // ---------------------------------------------------------
-  // Idea:
-  //   - If portfolio return at time t is negative, give higher score.
-  //   - Mix with uniform distribution so you still sample good states.
-  //
-  // λ = 0.0 → pure uniform bootstrap (no bias).
-  // λ = 1.0 → pure badness-driven bootstrap (always favor losses).
-  // Values in between blend the two.
-  // ---------------------------------------------------------
-  std::vector<double> score(T);
-  for (size_t t = 0; t < T; ++t) {
-    // Portfolio one-step return at row t
-    double port_r = selectedDataReturns_.row(t).dot(ew);
 
-    // Loss proxy: only care if return is negative
-    double loss_val = std::max(0.0, -port_r);
+  for (Eigen::Index t = oldRows; t < rows; ++t) {
+    logGrowthPrefix_.row(t + 1) =
+        logGrowthPrefix_.row(t).array()
+        + selectedDataReturns_.row(t).template cast<double>().array().log1p();
+  }
+}
 
-    // Quadratic penalty (large losses weigh more than small ones)
-    double badness = std::pow(loss_val, 2);
+template<typename Scalar>
+void BasicMonteCarloEngine<Scalar>::clearRunState_() {
+  samplerCache_.clear();
+  lastRun_.reset();
+  simulatedTail_.reset();
+  controlVariates_.clear();
+  likelihoodRatios_.clear();
+  drawnStarts_.clear();
+  scenarioReduction_ = ScenarioReduction{};
+}
 
-    // Blend with uniform baseline
-    // Ensures even good states have nonzero probability
-    score[t] = lambda * badness + (1.0 - lambda);
+template<typename Scalar>
+void BasicMonteCarloEngine<Scalar>::requireReturns_() const {
+  if (selectedDataReturns_.size() == 0) {
+    throw std::runtime_error("No category selected! Please select a category before running simulation."
+                             "Use selectCategory() method.");
   }
+}
 
-  // Normalize scores into probabilities
-  double Z = std::accumulate(score.begin(), score.end(), 0.0);
-  std::vector<double> prob(T);
-  for (size_t t = 0; t < T; ++t) prob[t] = score[t] / Z;
+template<typename Scalar>
+auto BasicMonteCarloEngine<Scalar>::runSingleSimulationVanilla(const size_t blockSize) -> Returns {
+  requireReturns_();
+  return materialiseBlocks_(drawVanillaBlocks_(blockSize, rng_));
+}
 
-  // Build discrete distribution from probabilities
-  std::discrete_distribution<size_t> distribution(prob.begin(), prob.end());
+template<typename Scalar>
+auto BasicMonteCarloEngine<Scalar>::runSingleSimulation(const size_t blockSize, const double lambda) -> Returns {
+  requireReturns_();
+  const auto sampler = startSampler_(SimulationMethod::LambdaBias, blockSize, lambda);
+  return materialiseBlocks_(drawLambdaBiasBlocks_(blockSize, *sampler, rng_));
+}
 
-  // ---------------------------------------------------------
-  // Step 2: Generate one bootstrap simulation
-  // ---------------------------------------------------------
-  Eigen::MatrixXd simulatedReturns(nSamples_, n_cols);
+template<typename Scalar>
+auto BasicMonteCarloEngine<Scalar>::runSingleSimulationStationary(const size_t blockSizeMean,
+                                                                  const double theta) -> Returns {
+  requireReturns_();
+  const auto sampler = startSampler_(SimulationMethod::Stationary, blockSizeMean, theta);
+  return materialiseBlocks_(drawStationaryBlocks_(blockSizeMean, *sampler, rng_));
+}
 
-  size_t filled = 0;
-  while (filled < nSamples_) {
-    // Pick a random block start (biased by prob[] scores)
-    size_t idx = distribution(rng_);
+template<typename Scalar>
+template<class URBG>
+BlockPath BasicMonteCarloEngine<Scalar>::drawVanillaBlocks_(const size_t blockSize,
+                                                             URBG &rng,
+                                                             const StartDesign *design,
+                                                             const size_t scenario) const {
+  // Generate uniform distribution
+  const size_t T = selectedDataReturns_.rows() - blockSize;
+  std::uniform_int_distribution<size_t> distribution(0, T - 1);
 
-    // Copy blockSize rows starting at idx
-    for (size_t b = 0; b < blockSize && filled < nSamples_; ++b) {
-      simulatedReturns.row(filled) = selectedDataReturns_.row(idx + b);
-      ++filled;
-    }
+  // Extract an index from the distribution for every block
+  // Whole rows are picked later on so that cross-correlation is kept
+  BlockPath blocks;
+  blocks.reserve(nSamples_ / blockSize + 1);
+  for (size_t row = 0; row < nSamples_ / blockSize + 1; row++) {
+    const size_t idx = design ? designedStart_(*design, scenario, row, rng) : distribution(rng);
+    const size_t filled = row * blockSize;
+    if (filled >= nSamples_) continue;  // The draw is still consumed to keep the stream aligned
+    blocks.push_back({idx, std::min(blockSize, nSamples_ - filled)});
   }
 
-  return simulatedReturns;
+  return blocks;
 }
 
-Eigen::MatrixXd MonteCarloEngine::runSingleSimulationStationary(const size_t blockSizeMean,
-                                                                const double theta) {
-  if (selectedDataReturns_.size() == 0) {
-    throw std::runtime_error(
-        "No category selected! Please select a category before running simulation. "
-        "Use selectCategory() method.");
-  }
-
+template<typename Scalar>
+std::vector<double> BasicMonteCarloEngine<Scalar>::startScores_(const SimulationMethod method,
+                                                                const size_t blockSize,
+                                                                const double parameter) const {
   const size_t N = selectedDataReturns_.rows();       // total observations
   const size_t n_cols = selectedDataReturns_.cols();  // number of assets
-  if (N == 0) throw std::runtime_error("Empty returns matrix.");
 
   // If no weights are set, use equal weights across assets
   std::vector<double> w = weightsVector_;
   if (w.empty()) w.assign(n_cols, 1.0 / n_cols);
   Eigen::Map<const Eigen::VectorXd> ew(w.data(), w.size());
 
-  // ---------------------------------------------------------
-  // Step 1: compute tilted probabilities over start indices
-  // ---------------------------------------------------------
-  // Portfolio one-step return used as proxy for "badness"
-  // theta = 0.0 → uniform (no tilt)
-  // theta > 0.0 → exponentially favors large losses
-  std::vector<double> score(N);
-  for (size_t t = 0; t < N; ++t) {
-    double port_r = selectedDataReturns_.row(static_cast<Eigen::Index>(t)).dot(ew);
-    double loss_val = std::max(0.0, -port_r);
-    score[t] = std::exp(theta * loss_val);
+  if (method == SimulationMethod::LambdaBias) {
+    // Total number of possible starting points for a block
+    // Example: if you have 1000 rows and blockSize=10, you can start at 0..990
+    const size_t T = N - blockSize + 1;
+    const double lambda = parameter;
+
+    // ---------------------------------------------------------
+    // Compute "badness scores" for each block start
+    // ---------------------------------------------------------
+    // Idea:
+    //   - If portfolio return at time t is negative, give higher score.
+    //   - Mix with uniform distribution so you still sample good states.
+    //
+    // λ = 0.0 → pure uniform bootstrap (no bias).
+    // λ = 1.0 → pure badness-driven bootstrap (always favor losses).
+    // Values in between blend the two.
+    // ---------------------------------------------------------
+    std::vector<double> score(T);
+    for (size_t t = 0; t < T; ++t) {
+      // Portfolio one-step return at row t
+      double port_r = selectedDataReturns_.row(static_cast<Eigen::Index>(t)).template cast<double>().dot(ew);
+
+      // Loss proxy: only care if return is negative
+      double loss_val = std::max(0.0, -port_r);
+
+      // Quadratic penalty (large losses weigh more than small ones)
+      double badness = std::pow(loss_val, 2);
+
+      // Blend with uniform baseline
+      // Ensures even good states have nonzero probability
+      score[t] = lambda * badness + (1.0 - lambda);
+    }
+    return score;
+  }
+
+  if (method == SimulationMethod::Stationary) {
+    const double theta = parameter;
+
+    // ---------------------------------------------------------
+    // Compute tilted scores over start indices
+    // ---------------------------------------------------------
+    // Portfolio one-step return used as proxy for "badness"
+    // theta = 0.0 → uniform (no tilt)
+    // theta > 0.0 → exponentially favors large losses
+    std::vector<double> score(N);
+    for (size_t t = 0; t < N; ++t) {
+      double port_r = selectedDataReturns_.row(static_cast<Eigen::Index>(t)).template cast<double>().dot(ew);
+      double loss_val = std::max(0.0, -port_r);
+      score[t] = std::exp(theta * loss_val);
+    }
+    return score;
+  }
+
+  throw std::runtime_error("Start scores are only defined for LambdaBias and Stationary methods!");
+}
+
+template<typename Scalar>
+std::shared_ptr<const AliasSampler> BasicMonteCarloEngine<Scalar>::startSampler_(const SimulationMethod method,
+                                                                                 const size_t blockSize,
+                                                                                 const double parameter) {
+  // The scores only depend on the support, the tilt parameter and the weights,
+  // so the table is rebuilt only when one of them changes
+  const size_t support = method == SimulationMethod::LambdaBias
+                             ? selectedDataReturns_.rows() - blockSize + 1
+                             : selectedDataReturns_.rows();
+
+  for (auto it = samplerCache_.begin(); it != samplerCache_.end(); ++it) {
+    if (it->method == method && it->support == support && it->parameter == parameter
+        && it->weights == weightsVector_) {
+      // Move the hit to the front so that the least recently used entry is evicted first
+      std::rotate(samplerCache_.begin(), it, std::next(it));
+      return samplerCache_.front().sampler;
+    }
+  }
+
+  auto sampler = std::make_shared<const AliasSampler>(startScores_(method, blockSize, parameter));
+  samplerCache_.insert(samplerCache_.begin(),
+                       SamplerCacheEntry{method, support, parameter, weightsVector_, sampler});
+  if (samplerCache_.size() > kSamplerCacheSize) samplerCache_.pop_back();
+
+  return sampler;
+}
+
+template<typename Scalar>
+template<class URBG>
+BlockPath BasicMonteCarloEngine<Scalar>::drawLambdaBiasBlocks_(const size_t blockSize,
+                                                               const AliasSampler &startSampler,
+                                                               URBG &rng,
+                                                               const StartDesign *design,
+                                                               const size_t scenario) const {
+  BlockPath blocks;
+  blocks.reserve(nSamples_ / blockSize + 1);
+
+  size_t filled = 0;
+  while (filled < nSamples_) {
+    // Pick a random block start (biased by the badness scores)
+    const size_t idx = design ? designedStart_(*design, scenario, blocks.size(), rng) : startSampler(rng);
+
+    // Take blockSize rows starting at idx
+    const size_t length = std::min(blockSize, nSamples_ - filled);
+    blocks.push_back({idx, length});
+    filled += length;
   }
 
-  double Z = std::accumulate(score.begin(), score.end(), 0.0);
-  if (Z <= 0.0) Z = 1.0;
-  std::vector<double> prob(N);
-  for (size_t t = 0; t < N; ++t) prob[t] = score[t] / Z;
+  return blocks;
+}
 
-  std::discrete_distribution<size_t> start_dist(prob.begin(), prob.end());
+template<typename Scalar>
+template<class URBG>
+BlockPath BasicMonteCarloEngine<Scalar>::drawStationaryBlocks_(const size_t blockSizeMean,
+                                                               const AliasSampler &startSampler,
+                                                               URBG &rng,
+                                                               const StartDesign *design,
+                                                               const size_t scenario) const {
+  const size_t N = selectedDataReturns_.rows();  // total observations
 
   // ---------------------------------------------------------
-  // Step 2: stationary bootstrap parameters
+  // Stationary bootstrap parameters
   // ---------------------------------------------------------
   // Block lengths are random ~ Geometric(p), mean length = blockSizeMean
   double p = (blockSizeMean > 0) ? (1.0 / static_cast<double>(blockSizeMean)) : 1.0;
@@ -299,94 +494,829 @@ Eigen::MatrixXd MonteCarloEngine::runSingleSimulationStationary(const size_t blo
   if (p > 1.0) p = 1.0;
   std::geometric_distribution<size_t> geom(p);
 
-  // Helper: circular row access
-  auto getRow = [&](size_t t) -> Eigen::RowVectorXd {
-    return selectedDataReturns_.row(static_cast<Eigen::Index>(t % N));
-  };
-
   // ---------------------------------------------------------
-  // Step 3: generate one bootstrap path
+  // Generate one bootstrap path
   // ---------------------------------------------------------
-  Eigen::MatrixXd simulatedReturns(nSamples_, n_cols);
+  BlockPath blocks;
   size_t filled = 0;
+  size_t draws = 0;
 
   while (filled < nSamples_) {
-    size_t idx0 = start_dist(rng_);  // pick starting index (tilted if theta > 0)
-    size_t L = geom(rng_) + 1;       // block length ≥ 1
+    // pick starting index (tilted if theta > 0)
+    size_t idx0 = design ? designedStart_(*design, scenario, draws++, rng) : startSampler(rng);
+    size_t L = geom(rng) + 1;         // block length ≥ 1
     if (L > nSamples_) L = nSamples_;
-
-    for (size_t b = 0; b < L && filled < nSamples_; ++b) {
-      simulatedReturns.row(static_cast<Eigen::Index>(filled)) = getRow(idx0 + b);
-      ++filled;
+    L = std::min(L, nSamples_ - filled);
+    filled += L;
+
+    // Rows are read circularly: split the block wherever it wraps past the last row
+    size_t start = idx0 % N;
+    bool wrapped = false;
+    while (L > 0) {
+      const size_t length = std::min(L, N - start);
+      blocks.push_back({start, length, wrapped});
+      L -= length;
+      start = 0;
+      wrapped = true;
     }
   }
 
+  return blocks;
+}
+
+template<typename Scalar>
+auto BasicMonteCarloEngine<Scalar>::materialiseBlocks_(const BlockPath &blocks) const -> Returns {
+  const auto n_cols = static_cast<size_t>(selectedDataReturns_.cols());
+  Returns simulatedReturns(nSamples_, n_cols);
+
+  // Both matrices are row-major: a block of rows is one contiguous run of scalars
+  Scalar *out = simulatedReturns.data();
+  for (const auto &[start, length, wrapped] : blocks) {
+    std::memcpy(out, selectedDataReturns_.row(static_cast<Eigen::Index>(start)).data(),
+                length * n_cols * sizeof(Scalar));
+    out += length * n_cols;
+  }
+
   return simulatedReturns;
 }
 
-void MonteCarloEngine::runSimulation(SimulationMethod method,
-                                     double param1,
-                                     double param2) {
+template<typename Scalar>
+Eigen::RowVectorXd BasicMonteCarloEngine<Scalar>::compoundBlocks_(const BlockPath &blocks) const {
+  // Same accumulation order as computeAssetLosses() on the materialised path
+  Eigen::RowVectorXd growth = Eigen::RowVectorXd::Ones(selectedDataReturns_.cols());
+  for (const auto &[start, length, wrapped] : blocks) {
+    for (size_t t = start; t < start + length; ++t) {
+      growth.array() *=
+          selectedDataReturns_.row(static_cast<Eigen::Index>(t)).template cast<double>().array() + 1.0;
+    }
+  }
+
+  return 1.0 - growth.array();
+}
+
+template<typename Scalar>
+Eigen::RowVectorXd BasicMonteCarloEngine<Scalar>::blockLosses_(const BlockPath &blocks) const {
+  // log(growth_j) = sum over blocks of P(start + length, j) - P(start, j)
+  Eigen::RowVectorXd logGrowth = Eigen::RowVectorXd::Zero(logGrowthPrefix_.cols());
+  for (const auto &[start, length, wrapped] : blocks) {
+    logGrowth += logGrowthPrefix_.row(static_cast<Eigen::Index>(start + length))
+                 - logGrowthPrefix_.row(static_cast<Eigen::Index>(start));
+  }
+
+  return 1.0 - logGrowth.array().exp();
+}
+
+template<typename Scalar>
+std::vector<double> BasicMonteCarloEngine<Scalar>::portfolioLogGrowthPrefix_() const {
+  Eigen::Map<const Eigen::VectorXd> w(weightsVector_.data(), static_cast<Eigen::Index>(weightsVector_.size()));
+  const auto rows = static_cast<size_t>(selectedDataReturns_.rows());
+
+  std::vector<double> prefix(rows + 1, 0.0);
+  for (size_t t = 0; t < rows; ++t) {
+    const double portfolioReturn =
+        selectedDataReturns_.row(static_cast<Eigen::Index>(t)).template cast<double>().dot(w);
+    prefix[t + 1] = prefix[t] + std::log1p(portfolioReturn);
+  }
+  return prefix;
+}
+
+template<typename Scalar>
+std::vector<double> BasicMonteCarloEngine<Scalar>::startProbabilities_(const SimulationRun &run) const {
+  if (run.startSampler) return run.startSampler->probabilities();
+
+  // Vanilla draws uniformly over the first rows - blockSize starts
+  const size_t support = selectedDataReturns_.rows() - run.blockSize;
+  return std::vector<double>(support, 1.0 / static_cast<double>(support));
+}
+
+template<typename Scalar>
+auto BasicMonteCarloEngine<Scalar>::startDesign_(const SimulationRun &run,
+                                                 const std::vector<double> &prefix,
+                                                 const size_t replicateSize,
+                                                 const size_t nPaths) const
+    -> std::shared_ptr<const StartDesign> {
+  auto design = std::make_shared<StartDesign>();
+  design->design = varianceReduction_;
+
+  // Rank the starts by the historical return of a typical block drawn from them, worst first,
+  // so that neighbouring quantiles hold similar blocks
+  const std::vector<double> probabilities = startProbabilities_(run);
+  const size_t length = std::max<size_t>(1, run.blockSize);
+  std::vector<double> blockGrowth(probabilities.size());
+  for (size_t t = 0; t < probabilities.size(); ++t) blockGrowth[t] = circularGrowth(prefix, t, length);
+
+  design->order.resize(probabilities.size());
+  std::iota(design->order.begin(), design->order.end(), size_t{0});
+  std::stable_sort(design->order.begin(), design->order.end(), [&](size_t a, size_t b) {
+    return blockGrowth[a] < blockGrowth[b];
+  });
+
+  design->cdf.resize(probabilities.size());
+  double cumulated = 0.0;
+  for (size_t r = 0; r < design->order.size(); ++r) {
+    cumulated += probabilities[design->order[r]];
+    design->cdf[r] = cumulated;
+  }
+  for (double &c : design->cdf) c /= cumulated;
+
+  // One random affine permutation of the strata per replicate and block position,
+  // stratum(i) = (a i + b) mod m with a coprime to m, drawn from a stream no path uses.
+  // Replicates are independent of each other, which is what the standard error relies on
+  design->replicateSize = std::max<size_t>(1, replicateSize);
+  design->positions = nSamples_ + 1;  // A path never has more blocks than this
+  if (design->design == VarianceReduction::Stratified) {
+    const size_t m = design->replicateSize;
+    const size_t nReplicates = (nPaths + m - 1) / m;
+    std::mt19937 rng = pathGenerator_(run.epoch, std::numeric_limits<size_t>::max());
+    std::uniform_int_distribution<size_t> multiplier(1, std::max<size_t>(1, m - 1));
+    std::uniform_int_distribution<size_t> shift(0, m - 1);
+
+    design->multipliers.resize(nReplicates * design->positions);
+    design->shifts.resize(nReplicates * design->positions);
+    for (size_t k = 0; k < design->multipliers.size(); ++k) {
+      size_t a = multiplier(rng);
+      while (std::gcd(a, m) != 1) a = multiplier(rng);
+      design->multipliers[k] = a;
+      design->shifts[k] = shift(rng);
+    }
+  }
+
+  return design;
+}
+
+template<typename Scalar>
+template<class URBG>
+size_t BasicMonteCarloEngine<Scalar>::designedStart_(const StartDesign &design,
+                                                     const size_t scenario,
+                                                     const size_t position,
+                                                     URBG &rng) const {
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  double u = uniform(rng);
+
+  if (design.design == VarianceReduction::Stratified) {
+    // Uniform within this path's stratum of its replicate
+    const size_t m = design.replicateSize;
+    const size_t k = scenario / m * design.positions + std::min(position, design.positions - 1);
+    const size_t stratum = (design.multipliers[k] * (scenario % m) + design.shifts[k]) % m;
+    u = (static_cast<double>(stratum) + u) / static_cast<double>(m);
+  }
+  if (design.design == VarianceReduction::Antithetic && scenario % 2 == 1) u = 1.0 - u;
+
+  // Inverse CDF over the ranked starts
+  const auto it = std::upper_bound(design.cdf.begin(), design.cdf.end(), u);
+  const auto rank = std::min<size_t>(static_cast<size_t>(it - design.cdf.begin()), design.order.size() - 1);
+  return design.order[rank];
+}
+
+template<typename Scalar>
+std::vector<double> BasicMonteCarloEngine<Scalar>::expectedBlockGrowth_(const SimulationRun &run,
+                                                                        const std::vector<double> &prefix,
+                                                                        const size_t maxLength) const {
+  const std::vector<double> probabilities = startProbabilities_(run);
+  std::vector<double> expected(maxLength + 1, 0.0);
+
+  parallelFor_(maxLength, [&](const size_t first, const size_t last) {
+    for (size_t length = first + 1; length <= last; ++length) {
+      for (size_t t = 0; t < probabilities.size(); ++t) {
+        expected[length] += probabilities[t] * circularGrowth(prefix, t, length);
+      }
+    }
+  });
+  return expected;
+}
+
+template<typename Scalar>
+double BasicMonteCarloEngine<Scalar>::pathControlVariate_(const BlockPath &blocks,
+                                                          const std::vector<double> &prefix,
+                                                          const std::vector<double> &expectedGrowth) {
+  // A drawn block is its first segment plus any wrapped continuations
+  double growth = 0.0;
+  double expectation = 0.0;
+  size_t drawnLength = 0;
+  for (const auto &[start, length, wrapped] : blocks) {
+    growth += prefix[start + length] - prefix[start];
+    if (!wrapped && drawnLength > 0) {
+      expectation += expectedGrowth[drawnLength];
+      drawnLength = 0;
+    }
+    drawnLength += length;
+  }
+  if (drawnLength > 0) expectation += expectedGrowth[drawnLength];
+
+  return growth - expectation;
+}
+
+template<typename Scalar>
+template<class URBG>
+BlockPath BasicMonteCarloEngine<Scalar>::drawBlocks_(const SimulationRun &run,
+                                                     const size_t scenario,
+                                                     URBG &rng) const {
+  const StartDesign *design = run.startDesign.get();
+  switch (run.method) {
+    case SimulationMethod::Vanilla:
+      return drawVanillaBlocks_(run.blockSize, rng, design, scenario);
+
+    case SimulationMethod::LambdaBias:
+      return drawLambdaBiasBlocks_(run.blockSize, *run.startSampler, rng, design, scenario);
+
+    case SimulationMethod::Stationary:
+      return drawStationaryBlocks_(run.blockSize, *run.startSampler, rng, design, scenario);
+
+    default:
+      throw std::runtime_error("Unknown simulation method");
+  }
+}
+
+template<typename Scalar>
+BlockPath BasicMonteCarloEngine<Scalar>::drawScenario_(const SimulationRun &run, const size_t scenario) const {
+  // The generator is rebuilt from (seed, epoch, scenario): no state is shared between scenarios.
+  // Antithetic pairs share the stream of their first path, so lengths and uniforms match
+  const bool antithetic = run.startDesign && run.startDesign->design == VarianceReduction::Antithetic;
+  const size_t stream = antithetic ? scenario - scenario % 2 : scenario;
+
+  if (run.generator == RandomGenerator::Philox) {
+    qd::random::Philox4x32 rng(seed_, stream, static_cast<uint32_t>(run.epoch));
+    return drawBlocks_(run, scenario, rng);
+  }
+
+  std::mt19937 rng = pathGenerator_(run.epoch, stream);
+  return drawBlocks_(run, scenario, rng);
+}
+
+template<typename Scalar>
+auto BasicMonteCarloEngine<Scalar>::prepareRun_(const SimulationMethod method,
+                                                const double param1,
+                                                const double param2) -> SimulationRun {
+  SimulationRun run{method, blockSize_, 0.0, nullptr, generator_, epoch_++, nullptr};
+
+  // Tilted methods share one alias table across all paths of this call (and later calls)
+  switch (method) {
+    case SimulationMethod::Vanilla:
+      // param1 = block size
+      run.blockSize = static_cast<size_t>(param1 > 0 ? param1 : blockSize_);
+      break;
+
+    case SimulationMethod::LambdaBias:
+      // param1 = lambda
+      run.tilt = param1;
+      run.startSampler = startSampler_(method, run.blockSize, run.tilt);
+      break;
+
+    case SimulationMethod::Stationary:
+      // param1 = mean block size, param2 = theta
+      run.blockSize = static_cast<size_t>(param1 > 0 ? param1 : blockSize_);
+      run.tilt = param2;
+      run.startSampler = startSampler_(method, run.blockSize, run.tilt);
+      break;
+
+    default:
+      throw std::runtime_error("Unknown simulation method");
+  }
+
+  return run;
+}
+
+template<typename Scalar>
+void BasicMonteCarloEngine<Scalar>::runSimulation(SimulationMethod method,
+                                                  double param1,
+                                                  double param2) {
+  requireReturns_();
+
+  // Every call draws fresh paths, but the sequence of calls after setSeed() is reproducible
+  const size_t replicateSize = (nSimulations_ + kStratifiedReplicates - 1) / kStratifiedReplicates;
+  beginRun_(method, param1, param2, replicateSize, nSimulations_);
+  growStorage_(nSimulations_);
+  simulateRange_(0, nSimulations_);
+  nDrawn_ = nSimulations_;
+  if (reducedScenarios_ > 0 && reducedScenarios_ < nDrawn_ && !simulatedTail_) reduceScenarios_();
+}
+
+template<typename Scalar>
+AdaptiveResult BasicMonteCarloEngine<Scalar>::runAdaptiveSimulation(const SimulationMethod method,
+                                                                    const double param1,
+                                                                    const double param2,
+                                                                    const AdaptiveOptions &options) {
+  requireReturns_();
+  if (storage_ == ScenarioStorage::Tail) {
+    throw std::runtime_error("Adaptive simulation needs every loss! Use a scenario storage other than "
+                             "ScenarioStorage::Tail.");
+  }
+  if (options.relativeTolerance <= 0.0 || options.confidence <= 0.0 || options.confidence >= 1.0) {
+    throw std::runtime_error("Adaptive simulation needs a positive tolerance and a confidence in (0, 1)!");
+  }
+
+  // Antithetic pairs must not straddle two batches
+  size_t batchSize = std::max<size_t>(2, options.batchSize);
+  if (varianceReduction_ == VarianceReduction::Antithetic) batchSize += batchSize % 2;
+  const size_t maxSimulations = std::max(batchSize, options.maxSimulations);
+  const double z = normalQuantile(0.5 + 0.5 * options.confidence);
+
+  // All batches belong to one run, so every path can still be replayed from its index.
+  // Latin hypercube replicates are sized on a batch
+  const size_t replicateSize = (batchSize + kStratifiedReplicates - 1) / kStratifiedReplicates;
+  beginRun_(method, param1, param2, replicateSize, maxSimulations);
+
+  AdaptiveResult result;
+  std::vector<double> batchES;  // Sectioning, for importance-sampled runs
+  size_t drawn = 0;
+  while (drawn < maxSimulations) {
+    const size_t next = std::min(maxSimulations, drawn + batchSize);
+    growStorage_(next);
+    simulateRange_(drawn, next);
+    nDrawn_ = next;
+    ++result.nBatches;
+
+    computeRiskContributions(RiskMeasure::ES);
+    const double ES = riskContributions_.back();
+    result.precision = riskPrecision_;
+    if (importanceSampling_ && !likelihoodRatios_.empty()) {
+      // The influence function does not cover the ratios: use the spread of the batch estimates
+      const LossMatrix<Scalar> batchLosses = simulatedLosses_.middleRows(
+          static_cast<Eigen::Index>(drawn), static_cast<Eigen::Index>(next - drawn));
+      const std::vector<double> batchRatios(likelihoodRatios_.begin() + static_cast<std::ptrdiff_t>(drawn),
+                                            likelihoodRatios_.end());
+      batchES.push_back(computeImportanceSampledRiskMeasures(
+          batchLosses, weightsVector_, batchRatios, alpha_, RiskMeasure::ES).back());
+
+      result.precision = RiskPrecision{next};
+      if (batchES.size() > 1) {
+        const double mean = std::accumulate(batchES.begin(), batchES.end(), 0.0) / static_cast<double>(batchES.size());
+        double ss = 0.0;
+        for (const double e : batchES) ss += (e - mean) * (e - mean);
+        const auto k = static_cast<double>(batchES.size());
+        result.precision.standardError = std::sqrt(ss / (k - 1.0) / k);
+      }
+    }
+    drawn = next;
+
+    // A handful of sections is needed before their spread means anything
+    const size_t minBatches = std::max<size_t>(batchES.empty() ? 1 : kMinSections, options.minBatches);
+    result.relativeHalfWidth = z * result.precision.standardError / std::abs(ES);
+    if (result.nBatches >= minBatches && result.relativeHalfWidth <= options.relativeTolerance) {
+      result.converged = true;
+      break;
+    }
+  }
+
+  return result;
+}
+
+template<typename Scalar>
+AnytimeResult BasicMonteCarloEngine<Scalar>::runAnytimeSimulation(const SimulationMethod method,
+                                                                  const double param1,
+                                                                  const double param2,
+                                                                  const RiskMeasure measure,
+                                                                  const std::chrono::steady_clock::time_point deadline,
+                                                                  const std::stop_token stop) {
+  using Clock = std::chrono::steady_clock;
+  requireReturns_();
+
+  // Same paths as runSimulation(), drawn in batches small enough to bound the overrun
+  const size_t replicateSize = (nSimulations_ + kStratifiedReplicates - 1) / kStratifiedReplicates;
+  beginRun_(method, param1, param2, replicateSize, nSimulations_);
+  const size_t batchSize = std::max<size_t>(1, nThreads_) * kAnytimeBatchPerThread;
+
+  // A batch is only started when one more batch as long as the last still fits
+  Clock::duration lastBatch{0};
+  while (nDrawn_ < nSimulations_ && !stop.stop_requested()) {
+    const auto start = Clock::now();
+    if (start + lastBatch > deadline) break;
+
+    const size_t next = std::min(nSimulations_, nDrawn_ + batchSize);
+    growStorage_(next);
+    simulateRange_(nDrawn_, next);
+    nDrawn_ = next;
+    lastBatch = Clock::now() - start;
+  }
+
+  AnytimeResult result;
+  result.nScenarios = nDrawn_;
+  result.completed = nDrawn_ == nSimulations_;
+  if (nDrawn_ == 0) {
+    riskContributions_.clear();
+    riskPrecision_ = RiskPrecision{};
+    return result;
+  }
+
+  computeRiskContributions(measure);
+  result.precision = riskPrecision_;
+  return result;
+}
+
+template<typename Scalar>
+void BasicMonteCarloEngine<Scalar>::beginRun_(const SimulationMethod method,
+                                              const double param1,
+                                              const double param2,
+                                              const size_t replicateSize,
+                                              const size_t nPaths) {
   // Clear previous results
   simulatedDataReturns_.clear();
+  simulatedBlocks_.clear();
+  simulatedTail_.reset();
+  drawnStarts_.clear();
+  controlVariates_.clear();
+  likelihoodRatios_.clear();
+  scenarioReduction_ = ScenarioReduction{};
+  nDrawn_ = 0;
+
+  const auto nAssets = static_cast<size_t>(selectedDataReturns_.cols());
+  simulatedLosses_.resize(0, static_cast<Eigen::Index>(nAssets));
+  if (storage_ == ScenarioStorage::Tail) {
+    simulatedTail_.emplace(nAssets, nSimulations_, alpha_);
+    tailWeights_ = weightsVector_;
+  }
 
-  for (size_t i = 0; i < nSimulations_; ++i) {
-    Eigen::MatrixXd sim;
+  lastRun_ = prepareRun_(method, param1, param2);
+  const SimulationRun &run = *lastRun_;
 
-    switch (method) {
-      case SimulationMethod::Vanilla:
-        // param1 = block size
-        sim = runSingleSimulationVanilla(static_cast<size_t>(param1 > 0 ? param1 : blockSize_));
-        break;
+  // Variance reduction works from the historical portfolio at the current weights
+  runPrefix_.clear();
+  expectedGrowth_.clear();
+  if (varianceReduction_ != VarianceReduction::None || controlVariate_) runPrefix_ = portfolioLogGrowthPrefix_();
+  if (varianceReduction_ != VarianceReduction::None) {
+    lastRun_->startDesign = startDesign_(run, runPrefix_, replicateSize, nPaths);
+  }
+  if (controlVariate_) {
+    const size_t maxLength = method == SimulationMethod::Stationary ? nSamples_ : run.blockSize;
+    expectedGrowth_ = expectedBlockGrowth_(run, runPrefix_, maxLength);
+  }
 
-      case SimulationMethod::LambdaBias:
-        // param1 = lambda
-        sim = runSingleSimulation(blockSize_, param1);
-        break;
+  // log u(s) - log q(s) for every possible start of a tilted run
+  logStartRatios_.clear();
+  if (run.startSampler) {
+    const auto &probabilities = run.startSampler->probabilities();
+    const double logUniform = -std::log(static_cast<double>(probabilities.size()));
+    logStartRatios_.resize(probabilities.size());
+    for (size_t t = 0; t < probabilities.size(); ++t) logStartRatios_[t] = logUniform - std::log(probabilities[t]);
+  }
+}
 
-      case SimulationMethod::Stationary:
-        // param1 = mean block size, param2 = theta
-        sim = runSingleSimulationStationary(static_cast<size_t>(param1 > 0 ? param1 : blockSize_),
-                                            param2);
-        break;
+template<typename Scalar>
+void BasicMonteCarloEngine<Scalar>::growStorage_(const size_t nPaths) {
+  const auto rows = static_cast<Eigen::Index>(nPaths);
+  if (!simulatedTail_) simulatedLosses_.conservativeResize(rows, selectedDataReturns_.cols());
+  if (storage_ == ScenarioStorage::Full) simulatedDataReturns_.resize(nPaths);
+  if (storage_ == ScenarioStorage::Compact) simulatedBlocks_.resize(nPaths);
+  if (controlVariate_) controlVariates_.resize(nPaths);
+  if (!logStartRatios_.empty()) likelihoodRatios_.resize(nPaths);
+}
+
+template<typename Scalar>
+void BasicMonteCarloEngine<Scalar>::simulateRange_(const size_t firstPath, const size_t lastPath) {
+  const SimulationRun &run = *lastRun_;
+  const auto nAssets = static_cast<size_t>(selectedDataReturns_.cols());
+  const bool tailOnly = simulatedTail_.has_value();
+  Eigen::Map<const Eigen::VectorXd> w(tailWeights_.data(), static_cast<Eigen::Index>(tailWeights_.size()));
+  std::mutex tailMutex;
+
+  // Rows only need copying when the whole path is kept
+  const bool prefixSum = lossAccumulation_ == LossAccumulation::PrefixSum;
+  const bool materialise = storage_ == ScenarioStorage::Full;
+
+  // Each path writes only its own slot and loss row, so no synchronisation is needed.
+  // Tails are kept per worker and merged once the worker is done
+  parallelFor_(lastPath - firstPath, [&](const size_t first, const size_t last) {
+    std::optional<TailAccumulator> workerTail;
+    if (tailOnly) workerTail.emplace(nAssets, nSimulations_, alpha_);
+
+    for (size_t i = firstPath + first; i < firstPath + last; ++i) {
+      BlockPath blocks = drawScenario_(run, scenarioOffset_ + i);
+      const auto row = static_cast<Eigen::Index>(i);
+
+      // Reduce the path as soon as it is generated, then keep it only if requested
+      const Eigen::Matrix<Scalar, 1, Eigen::Dynamic> losses =
+          (prefixSum ? blockLosses_(blocks) : compoundBlocks_(blocks)).template cast<Scalar>();
+      if (tailOnly) {
+        const Eigen::RowVectorXd assetLosses = losses.template cast<double>();
+        workerTail->add(i, assetLosses.dot(w), assetLosses);
+      } else {
+        simulatedLosses_.row(row) = losses;
+      }
+      if (controlVariate_) controlVariates_[i] = pathControlVariate_(blocks, runPrefix_, expectedGrowth_);
+      if (!logStartRatios_.empty()) {
+        double logRatio = 0.0;
+        for (const auto &[start, length, wrapped] : blocks) {
+          if (!wrapped) logRatio += logStartRatios_[start];
+        }
+        likelihoodRatios_[i] = std::exp(logRatio);
+      }
+      if (materialise) simulatedDataReturns_[i] = materialiseBlocks_(blocks);
+      if (storage_ == ScenarioStorage::Compact) simulatedBlocks_[i] = std::move(blocks);
+    }
+
+    if (workerTail) {
+      std::lock_guard<std::mutex> lock(tailMutex);
+      simulatedTail_->merge(*workerTail);
+    }
+  });
+}
+
+template<typename Scalar>
+void BasicMonteCarloEngine<Scalar>::parallelFor_(const size_t n,
+                                                 const std::function<void(size_t, size_t)> &body) const {
+  // Contiguous chunks, one per worker, on the shared pool: when the engine itself runs inside a
+  // pool task (a parallel sweep), the chunks spread over the same workers instead of new threads
+  qd::parallel::ThreadPool::global().parallel_for(n, nThreads_, body);
+}
+
+template<typename Scalar>
+void BasicMonteCarloEngine<Scalar>::requireRun_() const {
+  if (!lastRun_) {
+    throw std::runtime_error("No simulation run! Please run simulation before using its scenarios."
+                             "Use runSimulation() method.");
+  }
+}
+
+template<typename Scalar>
+void BasicMonteCarloEngine<Scalar>::requireLosses_() const {
+  requireRun_();
+  if (simulatedTail_) {
+    throw std::runtime_error("Only the tail of the last run was kept! Use a scenario storage other than "
+                             "ScenarioStorage::Tail to evaluate other weights or confidence levels.");
+  }
+}
 
-      default:
-        throw std::runtime_error("Unknown simulation method");
+template<typename Scalar>
+void BasicMonteCarloEngine<Scalar>::reduceScenarios_() {
+  // Importance-sampled paths enter with their likelihood ratios as masses
+  std::vector<double> masses;
+  if (importanceSampling_) masses = likelihoodRatios_;
+
+  scenarioReduction_ = reduceScenarios(simulatedLosses_, reducedScenarios_, weightsVector_, alpha_, masses, nThreads_);
+
+  Losses reduced(static_cast<Eigen::Index>(scenarioReduction_.scenarios.size()), simulatedLosses_.cols());
+  for (size_t k = 0; k < scenarioReduction_.scenarios.size(); ++k) {
+    reduced.row(static_cast<Eigen::Index>(k)) =
+        simulatedLosses_.row(static_cast<Eigen::Index>(scenarioReduction_.scenarios[k]));
+  }
+  simulatedLosses_ = std::move(reduced);
+}
+
+template<typename Scalar>
+std::vector<double> BasicMonteCarloEngine<Scalar>::reweightingRatios() {
+  requireRun_();
+  const SimulationRun &run = *lastRun_;
+  std::vector<double> ratios(nDrawn_, 1.0);
+  if (run.method == SimulationMethod::Vanilla) return ratios;
+
+  // Block-start distribution the scenarios would be drawn from at the current weights.
+  // Block lengths (geometric for Stationary) do not depend on the weights and cancel out
+  const auto current = startSampler_(run.method, run.blockSize, run.tilt);
+  const AliasSampler &drawn = *run.startSampler;
+  if (current == run.startSampler) return ratios;
+
+  // Drawn block starts of every scenario, collected once per run
+  if (drawnStarts_.size() != nDrawn_) {
+    drawnStarts_.assign(nDrawn_, {});
+    parallelFor_(nDrawn_, [&](const size_t first, const size_t last) {
+      for (size_t i = first; i < last; ++i) {
+        for (const auto &[start, length, wrapped] : scenarioBlocks(i)) {
+          if (!wrapped) drawnStarts_[i].push_back(start);
+        }
+      }
+    });
+  }
+
+  // log q_current(s) - log q_drawn(s) for every possible start s
+  std::vector<double> logStartRatios(drawn.size());
+  for (size_t t = 0; t < drawn.size(); ++t) {
+    logStartRatios[t] = std::log(current->probability(t)) - std::log(drawn.probability(t));
+  }
+
+  std::vector<double> logRatios(nDrawn_, 0.0);
+  parallelFor_(nDrawn_, [&](const size_t first, const size_t last) {
+    for (size_t i = first; i < last; ++i) {
+      for (const size_t start : drawnStarts_[i]) logRatios[i] += logStartRatios[start];
     }
+  });
+
+  // Ratios are only used self-normalised: shift by the maximum to avoid overflow
+  const double maxLog = *std::max_element(logRatios.begin(), logRatios.end());
+  if (!std::isfinite(maxLog)) {
+    throw std::runtime_error("Current weights give zero probability to every simulated scenario!");
+  }
+  for (size_t i = 0; i < nDrawn_; ++i) ratios[i] = std::exp(logRatios[i] - maxLog);
+
+  return ratios;
+}
+
+template<typename Scalar>
+std::vector<double> BasicMonteCarloEngine<Scalar>::reevaluateRiskContributions(const RiskMeasure measure) {
+  requireRun_();
+  // Importance-sampled figures target the untilted bootstrap, which does not depend on the weights
+  if (lastRun_->method == SimulationMethod::Vanilla || simulatedTail_ || importanceSampling_ ||
+      !scenarioReduction_.weights.empty()) {
+    return computeRiskContributions(measure);
+  }
+
+  riskPrecision_ = RiskPrecision{};
+  riskContributions_ = computeWeightedPortfolioRiskMeasures(
+      simulatedLosses_, weightsVector_, reweightingRatios(), alpha_, measure);
+
+  // The method returns only the vector of risk contributions without the portfolio one
+  return std::vector<double>(riskContributions_.begin(), riskContributions_.end() - 1);
+}
+
+template<typename Scalar>
+BlockPath BasicMonteCarloEngine<Scalar>::scenarioBlocks(const size_t scenario) const {
+  requireRun_();
+  if (scenario >= nDrawn_) {
+    throw std::out_of_range("Scenario index exceeds the number of simulations!");
+  }
+  if (!simulatedBlocks_.empty()) return simulatedBlocks_[scenario];
 
-    simulatedDataReturns_.push_back(std::move(sim));
+  return drawScenario_(*lastRun_, scenarioOffset_ + scenario);
+}
+
+template<typename Scalar>
+auto BasicMonteCarloEngine<Scalar>::materialiseScenario(const size_t scenario) const -> Returns {
+  if (!simulatedDataReturns_.empty()) {
+    if (scenario >= simulatedDataReturns_.size()) {
+      throw std::out_of_range("Scenario index exceeds the number of simulations!");
+    }
+    return simulatedDataReturns_[scenario];
   }
+
+  return materialiseBlocks_(scenarioBlocks(scenario));
 }
 
-std::vector<double> MonteCarloEngine::computeRiskContributions(const RiskMeasure measure, bool plotLosses) {
-  if (simulatedDataReturns_.empty()) {
+template<typename Scalar>
+Eigen::VectorXd BasicMonteCarloEngine<Scalar>::scenarioPortfolioReturns(const size_t scenario,
+                                                                        const std::vector<double> &weights) const {
+  if (weights.size() != static_cast<size_t>(selectedDataReturns_.cols())) {
+    throw std::runtime_error("Weights vector size does not match number of available tickers!");
+  }
+  Eigen::Map<const Eigen::VectorXd> w(weights.data(), static_cast<Eigen::Index>(weights.size()));
+
+  if (!simulatedDataReturns_.empty()) return materialiseScenario(scenario).template cast<double>() * w;
+
+  // Multiply each block of historical rows by the weights: no (nSamples x N) copy is needed
+  Eigen::VectorXd portfolioReturns(nSamples_);
+  Eigen::Index filled = 0;
+  for (const auto &[start, length, wrapped] : scenarioBlocks(scenario)) {
+    const auto len = static_cast<Eigen::Index>(length);
+    portfolioReturns.segment(filled, len) =
+        selectedDataReturns_.middleRows(static_cast<Eigen::Index>(start), len).template cast<double>() * w;
+    filled += len;
+  }
+
+  return portfolioReturns;
+}
+
+template<typename Scalar>
+auto BasicMonteCarloEngine<Scalar>::regenerateScenario(const size_t scenario) const -> Returns {
+  return materialiseBlocks_(scenarioBlocks(scenario));
+}
+
+template<typename Scalar>
+std::vector<double> BasicMonteCarloEngine<Scalar>::computeRiskContributions(const RiskMeasure measure, bool plotLosses) {
+  if (simulatedLosses_.rows() == 0 && !simulatedTail_) {
     throw std::runtime_error("No simulation run! Please run simulation before computing risk contributions."
                              "Use runSimulation() method.");
   }
 
-  // Get the matrix of portfolio losses, including marginal ones
-  riskContributions_ = computePortfolioRiskMeasures(
-      simulatedDataReturns_, weightsVector_, alpha_, measure, plotLosses);
+  riskPrecision_ = RiskPrecision{};
+  if (!scenarioReduction_.weights.empty()) {
+    // Reduced set: the clusters carry the mass of the paths they stand for
+    riskContributions_ = computeWeightedPortfolioRiskMeasures(
+        simulatedLosses_, weightsVector_, scenarioReduction_.weights, alpha_, measure);
+  } else if (importanceSampling_ && !likelihoodRatios_.empty()) {
+    // The kept tail was ranked without the ratios
+    requireLosses_();
+    if (plotLosses) computePortfolioRiskMeasures(simulatedLosses_, weightsVector_, alpha_, measure, true);
+    riskContributions_ = computeImportanceSampledRiskMeasures(
+        simulatedLosses_, weightsVector_, likelihoodRatios_, alpha_, measure);
+  } else if (simulatedTail_) {
+    // The tail was ranked by the portfolio loss at the simulated weights
+    if (weightsVector_ != tailWeights_) requireLosses_();
+    riskContributions_ = simulatedTail_->riskMeasures(weightsVector_, measure);
+  } else if (measure == RiskMeasure::ES) {
+    if (plotLosses) computePortfolioRiskMeasures(simulatedLosses_, weightsVector_, alpha_, measure, true);
+
+    // Paths are only independent across antithetic pairs or Latin hypercube replicates
+    size_t groupSize = 1;
+    if (const auto &design = lastRun_->startDesign) {
+      groupSize = design->design == VarianceReduction::Antithetic ? 2 : design->replicateSize;
+    }
+    riskContributions_ = computePortfolioESWithPrecision(
+        simulatedLosses_, weightsVector_, alpha_, controlVariates_, groupSize, riskPrecision_);
+  } else {
+    // Get the matrix of portfolio losses, including marginal ones
+    riskContributions_ = computePortfolioRiskMeasures(
+        simulatedLosses_, weightsVector_, alpha_, measure, plotLosses);
+  }
 
   // The method returns only the vector of risk contributions without the portfolio one
   return std::vector<double>(riskContributions_.begin(), riskContributions_.end() - 1);
 }
 
-std::vector<double> MonteCarloEngine::solveERC(const size_t maxIterations,
-                                               const SimulationMethod simMethod,
-                                               const double param1,
-                                               const double param2,
-                                               const double tol,            // relative tolerance on RC dispersion (vs ES)
-                                               const double eps_rc,         // floor to avoid division by ~0
-                                               const double damping,        // 0<damping<=1 (1=no damping). 0.3–0.7 helps stability
-                                               const bool verbose) {
+template<typename Scalar>
+Eigen::MatrixXd BasicMonteCarloEngine<Scalar>::computeRiskContributionsBatch(const RiskMeasure measure,
+                                                                             const Eigen::MatrixXd &weights) const {
+  requireLosses_();
+  const bool reduced = !scenarioReduction_.weights.empty();
+  if (!reduced && (!importanceSampling_ || likelihoodRatios_.empty())) {
+    return computePortfolioRiskMeasuresBatch(simulatedLosses_, weights, alpha_, measure);
+  }
+
+  // Weighted tails differ per portfolio, so they are evaluated one at a time
+  Eigen::MatrixXd results(weights.cols(), weights.rows() + 1);
+  for (Eigen::Index k = 0; k < weights.cols(); ++k) {
+    const Eigen::VectorXd column = weights.col(k);
+    const std::vector<double> portfolio(column.data(), column.data() + column.size());
+    const std::vector<double> measures =
+        reduced ? computeWeightedPortfolioRiskMeasures(simulatedLosses_, portfolio, scenarioReduction_.weights,
+                                                       alpha_, measure)
+                : computeImportanceSampledRiskMeasures(simulatedLosses_, portfolio, likelihoodRatios_, alpha_, measure);
+    results.row(k) = Eigen::Map<const Eigen::RowVectorXd>(measures.data(), static_cast<Eigen::Index>(measures.size()));
+  }
+  return results;
+}
+
+template<typename Scalar>
+RiskSurface BasicMonteCarloEngine<Scalar>::computeRiskSurface(const std::vector<double> &confidenceLevels) const {
+  requireLosses_();
+  if (!scenarioReduction_.weights.empty()) {
+    throw std::runtime_error("The risk surface needs equally likely scenarios! Disable the scenario "
+                             "reduction with setReducedScenarios(0).");
+  }
+  // Tilted scenarios estimate the untilted measures only through their likelihood ratios
+  if (importanceSampling_ && !likelihoodRatios_.empty()) {
+    return computeImportanceSampledRiskSurface(simulatedLosses_, weightsVector_, likelihoodRatios_, confidenceLevels);
+  }
+
+  return computePortfolioRiskSurface(simulatedLosses_, weightsVector_, confidenceLevels);
+}
+
+template<typename Scalar>
+std::vector<double> BasicMonteCarloEngine<Scalar>::solveCovarianceRiskParity(const double tol,
+                                                                             const size_t maxIterations,
+                                                                             const std::vector<double> &budgets) const {
+  requireReturns_();
+  const Eigen::MatrixXd returns = selectedDataReturns_.template cast<double>();
+  const auto n = returns.cols();
+  if (returns.rows() < 2) {
+    throw std::runtime_error("Not enough returns to estimate a covariance matrix!");
+  }
+
+  const Eigen::MatrixXd centred = returns.rowwise() - returns.colwise().mean();
+  const Eigen::MatrixXd covariance = centred.transpose() * centred / static_cast<double>(returns.rows() - 1);
+  if (!budgets.empty() && budgets.size() != static_cast<size_t>(n)) {
+    throw std::runtime_error("Risk budgets size does not match number of available tickers!");
+  }
+  Eigen::VectorXd budget = Eigen::VectorXd::Constant(n, 1.0 / static_cast<double>(n));
+  if (!budgets.empty()) {
+    budget = Eigen::Map<const Eigen::VectorXd>(budgets.data(), n);
+    if (!(budget.minCoeff() > 0.0)) {
+      throw std::runtime_error("Risk budgets must be positive!");
+    }
+    budget /= budget.sum();
+  }
+
+  // Start at inverse volatility, scaled so that y' S y = 1 as at the solution
+  Eigen::VectorXd y = covariance.diagonal().cwiseMax(1e-300).cwiseSqrt().cwiseInverse();
+  y /= std::sqrt(y.dot(covariance * y));
+
+  for (size_t iter = 0; iter < maxIterations; ++iter) {
+    const Eigen::VectorXd gradient = covariance * y - budget.cwiseQuotient(y);
+    Eigen::MatrixXd hessian = covariance;
+    hessian.diagonal() += budget.cwiseQuotient(y.cwiseAbs2());
+
+    const Eigen::VectorXd step = hessian.llt().solve(gradient);
+    const double decrement = std::sqrt(std::max(gradient.dot(step), 0.0));
+    if (decrement < tol) break;
+
+    // Damped while far from the solution (the objective is self-concordant), full steps near it
+    y -= decrement > 0.3 ? step / (1.0 + decrement) : step;
+  }
+
+  std::vector<double> weights(static_cast<size_t>(n));
+  const double total = y.sum();
+  for (Eigen::Index i = 0; i < n; ++i) weights[static_cast<size_t>(i)] = y(i) / total;
+  return weights;
+}
+
+template<typename Scalar>
+std::vector<double> BasicMonteCarloEngine<Scalar>::solveERC(const size_t maxIterations,
+                                                            const SimulationMethod simMethod,
+                                                            const double param1,
+                                                            const double param2,
+                                                            const double tol,            // relative tolerance on RC dispersion (vs ES)
+                                                            const double eps_rc,         // floor to avoid division by ~0
+                                                            const double damping,        // 0<damping<=1 (1=no damping). 0.3–0.7 helps stability
+                                                            const bool verbose,
+                                                            std::stop_token stop,
+                                                            const ERCSolver solver) {
   // Initialize the optimizer with the chosen simulation method + parameters
-  ERCOptimizer optimizer(*this,
-                         availableTickers_.size(),
-                         maxIterations,
-                         simMethod,
-                         param1,
-                         param2);
+  BasicERCOptimizer<Scalar> optimizer(*this,
+                                      availableTickers_.size(),
+                                      maxIterations,
+                                      simMethod,
+                                      param1,
+                                      param2);
+  optimizer.setStopToken(std::move(stop));
+  optimizer.setSolver(solver);
+  if (covarianceWarmStart_) optimizer.setInitialWeights(solveCovarianceRiskParity());
 
   // Run the optimization
   std::vector<double> optimalWeights = optimizer.optimize(
@@ -395,3 +1325,6 @@ std::vector<double> MonteCarloEngine::solveERC(const size_t maxIterations,
 
   return optimalWeights;
 }
+
+template class BasicMonteCarloEngine<float>;
+template class BasicMonteCarloEngine<double>;
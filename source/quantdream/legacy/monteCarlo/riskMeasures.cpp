@@ -4,10 +4,72 @@
 #include <Eigen/Dense>
 #include <vector>
 #include <algorithm>
+#include <cmath>
+#include <numeric>
 #include <stdexcept>
 #include "quantdream/legacy/monteCarlo/riskMeasures.h"
 #include "quantdream/legacy/monteCarlo/utils.h"
 
+namespace {
+
+// Partially order the scenarios by portfolio loss with a selection (O(n) on average) instead
+// of a full sort. Returns the scenario at the alpha-quantile (the VaR scenario) and fills
+// tailRows with every scenario at or above it, in increasing row order
+template<typename Vector>
+size_t selectTail(const Vector &portfolioLosses, const size_t alpha, std::vector<size_t> &tailRows) {
+  const auto nSimulations = static_cast<size_t>(portfolioLosses.size());
+  if (nSimulations == 0) {
+    throw std::runtime_error("No scenarios to compute the risk measure on!");
+  }
+
+  // Retrieve alpha-quantile index
+  auto quantileIndex = static_cast<size_t>(std::floor((1 - alpha / 100.0) * nSimulations));
+  if (quantileIndex >= nSimulations) quantileIndex = nSimulations - 1;
+
+  std::vector<size_t> indices(nSimulations);
+  std::iota(indices.begin(), indices.end(), size_t{0});
+  const auto quantile = indices.begin() + static_cast<std::ptrdiff_t>(quantileIndex);
+  std::nth_element(indices.begin(), quantile, indices.end(), [&](size_t a, size_t b) {
+    return portfolioLosses(static_cast<Eigen::Index>(a)) < portfolioLosses(static_cast<Eigen::Index>(b));
+  });
+
+  // Row order makes the gather below walk forward through memory
+  const size_t varRow = *quantile;
+  tailRows.assign(quantile, indices.end());
+  std::sort(tailRows.begin(), tailRows.end());
+
+  return varRow;
+}
+
+// Mean per-asset loss over the tail. The tail rows are first gathered into one contiguous
+// row-major buffer, so the column sums are vectorised reductions rather than scattered reads
+template<typename Scalar>
+Eigen::RowVectorXd tailMean(const LossMatrix<Scalar> &assetLosses, const std::vector<size_t> &tailRows) {
+  BasicReturnsMatrix<double> tail(static_cast<Eigen::Index>(tailRows.size()), assetLosses.cols());
+  for (size_t k = 0; k < tailRows.size(); ++k) {
+    tail.row(static_cast<Eigen::Index>(k)) =
+        assetLosses.row(static_cast<Eigen::Index>(tailRows[k])).template cast<double>();
+  }
+
+  return tail.colwise().sum() / static_cast<double>(tailRows.size());
+}
+
+// Confidence levels sorted increasingly without duplicates, each checked to lie in (0, 1)
+std::vector<double> sortedLevels(const std::vector<double> &confidenceLevels) {
+  if (confidenceLevels.empty()) {
+    throw std::runtime_error("At least one confidence level is required!");
+  }
+  std::vector<double> levels = confidenceLevels;
+  std::sort(levels.begin(), levels.end());
+  levels.erase(std::unique(levels.begin(), levels.end()), levels.end());
+  if (!(levels.front() > 0.0) || !(levels.back() < 1.0)) {
+    throw std::runtime_error("Confidence levels must lie in (0, 1)!");
+  }
+  return levels;
+}
+
+}  // namespace
+
 // Matrix structure:
 // Cols: Loss_asset_0 | ... | Loss_asset_N-1 | Portfolio_Loss
 // Rows: Simulation_0
@@ -15,89 +77,450 @@
 //        .
 //        .
 // Rows: Simulation_M-1
-std::vector<double> computePortfolioRiskMeasures(const std::vector<Eigen::MatrixXd> &simulatedReturns,
+template<typename Scalar>
+std::vector<double> computePortfolioRiskMeasures(const LossMatrix<Scalar> &assetLosses,
                                              const std::vector<double> &weights,
                                              const size_t &alpha,
                                              const RiskMeasure &measure,
                                              const bool plotLosses) {
   // Get the dimension of the output matrix
-  const size_t nSimulations = simulatedReturns.size();
+  const size_t nSimulations = assetLosses.rows();
   const size_t nAssets = weights.size();
+  if (static_cast<size_t>(assetLosses.cols()) != nAssets) {
+    throw std::runtime_error("Asset losses and weights have different number of assets!");
+  }
 
-  // Construct the random variable
-  Eigen::MatrixXd riskMeasureMatrix(nSimulations, nAssets + 1);
+  // Convert weights to Eigen vector
+  Eigen::VectorXd eigenWeights =
+      Eigen::Map<const Eigen::VectorXd>(weights.data(),
+      static_cast<Eigen::Index>(weights.size()));
 
-  // Select the correct function to compute the risk measure
-  // auto riskFunction = (measure == RiskMeasure::VaR) ? computeVaR : computeES;
+  // For each simulation, compute the portfolio loss from the losses of each asset
+  // (in the scalar type of the losses, then widened for the tail statistics)
+  const Eigen::VectorXd portfolioLosses =
+      (assetLosses * eigenWeights.template cast<Scalar>()).template cast<double>();
 
-  // For each simulation, compute the portfolio loss and the losses of each asset
-  for (size_t i = 0; i < nSimulations; i++) {
-    // Compute the portfolio losses of the i-th simulation
-    // To compute the loss, we can use the formula:
-    // loss_j = prod (1 + return_ij)
-    // total_loss_j = 1 - prod (1 + loss_j)
-    // Transposition is needed to have a column vector of losses
-    Eigen::VectorXd losses = (1 - (simulatedReturns[i].array() + 1).colwise().prod()).transpose();
+  if (plotLosses) {
+    Eigen::MatrixXd riskMeasureMatrix(nSimulations, nAssets + 1);
+    riskMeasureMatrix.leftCols(nAssets) = assetLosses.template cast<double>();
+    riskMeasureMatrix.col(nAssets) = portfolioLosses;
+    plotPortfolioLosses(riskMeasureMatrix);
+  }
+
+  // Find the alpha-quantile and the tail without sorting every scenario
+  std::vector<size_t> tailRows;
+  const size_t varRow = selectTail(portfolioLosses, alpha, tailRows);
+
+  std::vector<double> results(nAssets + 1, 0.0);
+  if (measure == RiskMeasure::VaR) {
+    const auto row = static_cast<Eigen::Index>(varRow);
+    for (size_t j = 0; j < nAssets; ++j) {
+      // Compute the marginal VaR for each asset
+      results[j] = static_cast<double>(assetLosses(row, static_cast<Eigen::Index>(j))) * weights[j];
+    }
+    // Compute the VaR
+    results[nAssets] = portfolioLosses(row);
+  }
+
+  if (measure == RiskMeasure::ES) {
+    const Eigen::RowVectorXd assetES = tailMean(assetLosses, tailRows);
+    for (size_t j = 0; j < nAssets; ++j) {
+      // Compute the marginal ES for each asset
+      results[j] = assetES(static_cast<Eigen::Index>(j)) * weights[j];
+    }
 
-    // Convert weights to Eigen vector
-    Eigen::VectorXd eigenWeights =
-        Eigen::Map<const Eigen::VectorXd>(weights.data(),
-        static_cast<Eigen::Index>(weights.size()));
+    // Compute the ES
+    for (const size_t row : tailRows) results[nAssets] += portfolioLosses(static_cast<Eigen::Index>(row));
+    results[nAssets] /= static_cast<double>(tailRows.size());
+  }
 
-    // Compute the portfolio loss
-    double portfolioLoss = losses.dot(eigenWeights);
+  return results;
+}
 
-    // Insert into riskMeasureMatrix losses
-    riskMeasureMatrix.row(i).head(nAssets) = losses;
-    riskMeasureMatrix(i, nAssets) = portfolioLoss;
+template<typename Scalar>
+Eigen::MatrixXd computePortfolioRiskMeasuresBatch(const LossMatrix<Scalar> &assetLosses,
+                                                  const Eigen::MatrixXd &weights,
+                                                  const size_t &alpha,
+                                                  const RiskMeasure &measure) {
+  const Eigen::Index nSimulations = assetLosses.rows();
+  const Eigen::Index nAssets = assetLosses.cols();
+  const Eigen::Index nPortfolios = weights.cols();
+  if (weights.rows() != nAssets) {
+    throw std::runtime_error("Asset losses and weights have different number of assets!");
+  }
+  if (nSimulations == 0) {
+    throw std::runtime_error("No scenarios to compute the risk measure on!");
   }
 
-  if (plotLosses) { plotPortfolioLosses(riskMeasureMatrix); }
+  // Portfolio losses of every portfolio in every scenario: (nSimulations x K).
+  // The product runs in the scalar type of the losses, the tail sums in double
+  const Eigen::MatrixXd portfolioLosses =
+      (assetLosses * weights.template cast<Scalar>()).template cast<double>();
 
-  // Order portfolio losses in increasing order
-  // and get the index of the alpha-quantile
-  // Fill portfolioLosses and indices
-  std::vector<double> portfolioLosses(nSimulations);
-  std::vector<std::size_t> indices(nSimulations);
+  Eigen::MatrixXd results(nPortfolios, nAssets + 1);
+  std::vector<size_t> tailRows;
 
-  for (Eigen::Index i = 0; i < nSimulations; ++i) {
-    portfolioLosses[i] = riskMeasureMatrix(i, static_cast<Eigen::Index>(nAssets));
-    indices[i] = i;
+  for (Eigen::Index k = 0; k < nPortfolios; ++k) {
+    // Same selection and gather as the single-portfolio version, one column at a time
+    const auto portfolioLoss = portfolioLosses.col(k);
+    const size_t varRow = selectTail(portfolioLoss, alpha, tailRows);
+
+    Eigen::RowVectorXd assetRisk;
+    double portfolioRisk = 0.0;
+    if (measure == RiskMeasure::VaR) {
+      assetRisk = assetLosses.row(static_cast<Eigen::Index>(varRow)).template cast<double>();
+      portfolioRisk = portfolioLoss(static_cast<Eigen::Index>(varRow));
+    }
+
+    if (measure == RiskMeasure::ES) {
+      assetRisk = tailMean(assetLosses, tailRows);
+      for (const size_t row : tailRows) portfolioRisk += portfolioLoss(static_cast<Eigen::Index>(row));
+      portfolioRisk /= static_cast<double>(tailRows.size());
+    }
+
+    // Marginal VaR / ES of each asset
+    results.row(k).head(nAssets) = assetRisk.cwiseProduct(weights.col(k).transpose());
+    results(k, nAssets) = portfolioRisk;
   }
 
-  // Sort indices based on the values in portfolioLosses
-  std::sort(indices.begin(), indices.end(),
-    // [&] is used to capture outer scope variables by reference
-    [&](size_t a, size_t b) {
-      return portfolioLosses[a] < portfolioLosses[b];
-    });
+  return results;
+}
 
-  // Retrieve alpha-quantile index
-  auto quantileIndex = static_cast<size_t>(std::floor((1 - alpha / 100.0) * nSimulations));
-  if (quantileIndex >= nSimulations) quantileIndex = nSimulations - 1;
+template<typename Scalar>
+std::vector<double> computePortfolioESWithPrecision(const LossMatrix<Scalar> &assetLosses,
+                                                    const std::vector<double> &weights,
+                                                    const size_t &alpha,
+                                                    const std::vector<double> &controls,
+                                                    const size_t groupSize,
+                                                    RiskPrecision &precision) {
+  const auto nSimulations = static_cast<size_t>(assetLosses.rows());
+  const size_t nAssets = weights.size();
+  if (static_cast<size_t>(assetLosses.cols()) != nAssets) {
+    throw std::runtime_error("Asset losses and weights have different number of assets!");
+  }
+  if (!controls.empty() && controls.size() != nSimulations) {
+    throw std::runtime_error("Control variates and asset losses have different number of scenarios!");
+  }
+
+  Eigen::Map<const Eigen::VectorXd> eigenWeights(weights.data(), static_cast<Eigen::Index>(nAssets));
+  const Eigen::VectorXd portfolioLosses =
+      (assetLosses * eigenWeights.template cast<Scalar>()).template cast<double>();
+
+  // Plain estimate, exactly as computePortfolioRiskMeasures
+  std::vector<size_t> tailRows;
+  const double VaR = portfolioLosses(static_cast<Eigen::Index>(selectTail(portfolioLosses, alpha, tailRows)));
+  const auto nTail = static_cast<double>(tailRows.size());
+  const double tailFraction = nTail / static_cast<double>(nSimulations);
+
+  std::vector<double> results(nAssets + 1, 0.0);
+  const Eigen::RowVectorXd assetES = tailMean(assetLosses, tailRows);
+  for (size_t j = 0; j < nAssets; ++j) results[j] = assetES(static_cast<Eigen::Index>(j)) * weights[j];
+  for (const size_t row : tailRows) results[nAssets] += portfolioLosses(static_cast<Eigen::Index>(row));
+  results[nAssets] /= nTail;
+
+  // Influence of each scenario on the estimate
+  std::vector<double> influence(nSimulations, VaR);
+  for (const size_t row : tailRows) {
+    influence[row] += (portfolioLosses(static_cast<Eigen::Index>(row)) - VaR) / tailFraction;
+  }
+  std::vector<double> adjustedInfluence = influence;
+
+  if (!controls.empty()) {
+    const double controlMean =
+        std::accumulate(controls.begin(), controls.end(), 0.0) / static_cast<double>(nSimulations);
+    double controlSS = 0.0;
+    for (const double c : controls) controlSS += (c - controlMean) * (c - controlMean);
+
+    if (controlSS > 0.0) {
+      // Influence of each asset's contribution, Y_ij = (w_j L_ij - s_j VaR) / tailFraction on the
+      // tail and 0 elsewhere, where s_j is the asset's share of the ES; the Y_ij sum to psi_i - VaR
+      const double portfolioES = results[nAssets];
+      Eigen::RowVectorXd shares(static_cast<Eigen::Index>(nAssets));
+      for (size_t j = 0; j < nAssets; ++j) shares(static_cast<Eigen::Index>(j)) = results[j] / portfolioES;
+
+      Eigen::RowVectorXd crossSum = Eigen::RowVectorXd::Zero(static_cast<Eigen::Index>(nAssets));
+      Eigen::RowVectorXd influenceSum = Eigen::RowVectorXd::Zero(static_cast<Eigen::Index>(nAssets));
+      for (const size_t row : tailRows) {
+        const Eigen::RowVectorXd y =
+            (assetLosses.row(static_cast<Eigen::Index>(row)).template cast<double>().cwiseProduct(
+                 eigenWeights.transpose()) - shares * VaR) / tailFraction;
+        crossSum += controls[row] * y;
+        influenceSum += y;
+      }
+
+      // One regression coefficient per asset; the portfolio's is their sum
+      double beta = 0.0;
+      for (size_t j = 0; j < nAssets; ++j) {
+        const auto k = static_cast<Eigen::Index>(j);
+        const double betaJ = (crossSum(k) - influenceSum(k) * controlMean) / controlSS;
+        results[j] -= betaJ * controlMean;
+        beta += betaJ;
+      }
+      results[nAssets] -= beta * controlMean;
+      for (size_t i = 0; i < nSimulations; ++i) adjustedInfluence[i] -= beta * (controls[i] - controlMean);
+    }
+  }
+
+  // Variance of the plain estimator from independent scenarios, against the variance of the
+  // group means under the actual sampling design
+  const auto sampleVariance = [](const std::vector<double> &values) {
+    const double mean = std::accumulate(values.begin(), values.end(), 0.0) / static_cast<double>(values.size());
+    double ss = 0.0;
+    for (const double v : values) ss += (v - mean) * (v - mean);
+    return ss / static_cast<double>(values.size() - 1);
+  };
+
+  const size_t group = std::max<size_t>(1, groupSize);
+  std::vector<double> groupMeans;
+  for (size_t first = 0; first < nSimulations; first += group) {
+    const size_t last = std::min(nSimulations, first + group);
+    groupMeans.push_back(std::accumulate(adjustedInfluence.begin() + static_cast<std::ptrdiff_t>(first),
+                                         adjustedInfluence.begin() + static_cast<std::ptrdiff_t>(last), 0.0)
+                         / static_cast<double>(last - first));
+  }
+
+  precision = RiskPrecision{nSimulations};
+  precision.effectiveSampleSize = static_cast<double>(nSimulations);
+  if (groupMeans.size() > 1) {
+    const double designVariance = sampleVariance(groupMeans) / static_cast<double>(groupMeans.size());
+    const double plainVariance = sampleVariance(influence) / static_cast<double>(nSimulations);
+    precision.standardError = std::sqrt(designVariance);
+    if (designVariance > 0.0) {
+      precision.effectiveSampleSize = static_cast<double>(nSimulations) * plainVariance / designVariance;
+    }
+  }
+
+  return results;
+}
+
+template<typename Scalar>
+RiskSurface computePortfolioRiskSurface(const LossMatrix<Scalar> &assetLosses,
+                                        const std::vector<double> &weights,
+                                        const std::vector<double> &confidenceLevels) {
+  const auto nSimulations = static_cast<size_t>(assetLosses.rows());
+  const size_t nAssets = weights.size();
+  if (static_cast<size_t>(assetLosses.cols()) != nAssets) {
+    throw std::runtime_error("Asset losses and weights have different number of assets!");
+  }
+  if (nSimulations == 0) {
+    throw std::runtime_error("No scenarios to compute the risk measure on!");
+  }
+
+  RiskSurface surface;
+  surface.confidenceLevels = sortedLevels(confidenceLevels);
+  const size_t nLevels = surface.confidenceLevels.size();
+
+  Eigen::Map<const Eigen::VectorXd> eigenWeights(weights.data(), static_cast<Eigen::Index>(nAssets));
+  const Eigen::VectorXd portfolioLosses =
+      (assetLosses * eigenWeights.template cast<Scalar>()).template cast<double>();
+
+  // Quantile index of every level, as in the single-level estimator
+  std::vector<size_t> quantileIndices(nLevels);
+  for (size_t l = 0; l < nLevels; ++l) {
+    auto q = static_cast<size_t>(std::floor(surface.confidenceLevels[l] * nSimulations));
+    quantileIndices[l] = std::min(q, nSimulations - 1);
+  }
+
+  // One selection at the lowest level isolates every tail; only that tail is then sorted.
+  // Ties are broken by row so that the result does not depend on the selection
+  const auto byLoss = [&](size_t a, size_t b) {
+    const double la = portfolioLosses(static_cast<Eigen::Index>(a));
+    const double lb = portfolioLosses(static_cast<Eigen::Index>(b));
+    return la < lb || (la == lb && a < b);
+  };
+  std::vector<size_t> indices(nSimulations);
+  std::iota(indices.begin(), indices.end(), size_t{0});
+  const auto widest = indices.begin() + static_cast<std::ptrdiff_t>(quantileIndices.front());
+  std::nth_element(indices.begin(), widest, indices.end(), byLoss);
+  std::sort(widest, indices.end(), byLoss);
+
+  // Gather the sorted tail into a contiguous buffer: row k is scenario indices[q0 + k]
+  const size_t q0 = quantileIndices.front();
+  const size_t tailSize = nSimulations - q0;
+  BasicReturnsMatrix<double> tail(static_cast<Eigen::Index>(tailSize), static_cast<Eigen::Index>(nAssets + 1));
+  for (size_t k = 0; k < tailSize; ++k) {
+    const auto row = static_cast<Eigen::Index>(indices[q0 + k]);
+    tail.row(static_cast<Eigen::Index>(k)).head(nAssets) = assetLosses.row(row).template cast<double>();
+    tail(static_cast<Eigen::Index>(k), static_cast<Eigen::Index>(nAssets)) = portfolioLosses(row);
+  }
+
+  Eigen::RowVectorXd eulerWeights(nAssets + 1);
+  eulerWeights.head(nAssets) = eigenWeights.transpose();
+  eulerWeights(static_cast<Eigen::Index>(nAssets)) = 1.0;
+
+  surface.VaR.resize(static_cast<Eigen::Index>(nLevels), static_cast<Eigen::Index>(nAssets + 1));
+  surface.ES.resize(static_cast<Eigen::Index>(nLevels), static_cast<Eigen::Index>(nAssets + 1));
+
+  // Walk the tail from the largest loss down, closing each level's suffix sum on the way
+  Eigen::RowVectorXd suffixSum = Eigen::RowVectorXd::Zero(static_cast<Eigen::Index>(nAssets + 1));
+  size_t next = tailSize;
+  for (size_t l = nLevels; l-- > 0;) {
+    const size_t first = quantileIndices[l] - q0;
+    for (; next > first; --next) suffixSum += tail.row(static_cast<Eigen::Index>(next - 1));
+
+    const auto level = static_cast<Eigen::Index>(l);
+    surface.VaR.row(level) = tail.row(static_cast<Eigen::Index>(first)).cwiseProduct(eulerWeights);
+    surface.ES.row(level) =
+        (suffixSum / static_cast<double>(nSimulations - quantileIndices[l])).cwiseProduct(eulerWeights);
+  }
+
+  return surface;
+}
+
+template<typename Scalar>
+std::vector<double> computeWeightedPortfolioRiskMeasures(const LossMatrix<Scalar> &assetLosses,
+                                                         const std::vector<double> &weights,
+                                                         const std::vector<double> &scenarioWeights,
+                                                         const size_t &alpha,
+                                                         const RiskMeasure &measure) {
+  const size_t nSimulations = assetLosses.rows();
+  const size_t nAssets = weights.size();
+  if (static_cast<size_t>(assetLosses.cols()) != nAssets) {
+    throw std::runtime_error("Asset losses and weights have different number of assets!");
+  }
+  if (scenarioWeights.size() != nSimulations) {
+    throw std::runtime_error("Scenario weights and asset losses have different number of scenarios!");
+  }
+  if (nSimulations == 0) {
+    throw std::runtime_error("No scenarios to compute the risk measure on!");
+  }
+
+  Eigen::Map<const Eigen::VectorXd> eigenWeights(weights.data(), static_cast<Eigen::Index>(nAssets));
+  const Eigen::VectorXd portfolioLosses =
+      (assetLosses * eigenWeights.template cast<Scalar>()).template cast<double>();
+
+  // Order portfolio losses in decreasing order, then walk down the tail
+  std::vector<size_t> indices(nSimulations);
+  std::iota(indices.begin(), indices.end(), size_t{0});
+  std::sort(indices.begin(), indices.end(), [&](size_t a, size_t b) {
+    return portfolioLosses(static_cast<Eigen::Index>(a)) > portfolioLosses(static_cast<Eigen::Index>(b));
+  });
+
+  double totalWeight = 0.0;
+  for (const double w : scenarioWeights) {
+    if (w < 0.0) throw std::runtime_error("Scenario weights must be non-negative!");
+    totalWeight += w;
+  }
+  if (totalWeight <= 0.0) {
+    throw std::runtime_error("Scenario weights must have a positive sum!");
+  }
+
+  // Relative slack absorbs rounding in the running sum so that equal weights
+  // pick exactly ceil(alpha% * n) scenarios, as the unweighted estimator does
+  const double tailWeight = (alpha / 100.0) * totalWeight * (1.0 - 1e-12);
+
+  std::vector<double> results(nAssets + 1, 0.0);
+  double accumulated = 0.0;
+  size_t last = 0;
+  for (size_t k = 0; k < nSimulations; ++k) {
+    const size_t i = indices[k];
+    last = i;
+    if (measure == RiskMeasure::ES && scenarioWeights[i] > 0.0) {
+      const auto row = static_cast<Eigen::Index>(i);
+      for (size_t j = 0; j < nAssets; ++j) {
+        results[j] += scenarioWeights[i] * static_cast<double>(assetLosses(row, static_cast<Eigen::Index>(j)));
+      }
+      results[nAssets] += scenarioWeights[i] * portfolioLosses(row);
+    }
+    accumulated += scenarioWeights[i];
+    if (accumulated >= tailWeight && scenarioWeights[i] > 0.0) break;
+  }
 
-  std::vector<double> results(nAssets + 1);
   if (measure == RiskMeasure::VaR) {
+    // The VaR is the smallest loss in the tail
+    const auto row = static_cast<Eigen::Index>(last);
+    for (size_t j = 0; j < nAssets; ++j) {
+      results[j] = static_cast<double>(assetLosses(row, static_cast<Eigen::Index>(j))) * weights[j];
+    }
+    results[nAssets] = portfolioLosses(row);
+  }
+
+  if (measure == RiskMeasure::ES) {
     for (size_t j = 0; j < nAssets + 1; ++j) {
-      // Compute the VaR
-      results[j] = riskMeasureMatrix(indices[quantileIndex], j);
+      results[j] /= accumulated;
 
       if (j < nAssets) {
-        // Compute the marginal VaR for each asset
+        // Compute the marginal ES for each asset
         results[j] *= weights[j];
       }
     }
   }
 
-  if (measure == RiskMeasure::ES) {
-    for (size_t i = quantileIndex; i < nSimulations; ++i) {
-      for (size_t j = 0; j < nAssets + 1; ++j) {
-        results[j] += riskMeasureMatrix(indices[i], j);
+  return results;
+}
+
+template<typename Scalar>
+std::vector<double> computeImportanceSampledRiskMeasures(const LossMatrix<Scalar> &assetLosses,
+                                                         const std::vector<double> &weights,
+                                                         const std::vector<double> &likelihoodRatios,
+                                                         const size_t &alpha,
+                                                         const RiskMeasure &measure) {
+  const size_t nSimulations = assetLosses.rows();
+  const size_t nAssets = weights.size();
+  if (static_cast<size_t>(assetLosses.cols()) != nAssets) {
+    throw std::runtime_error("Asset losses and weights have different number of assets!");
+  }
+  if (likelihoodRatios.size() != nSimulations) {
+    throw std::runtime_error("Likelihood ratios and asset losses have different number of scenarios!");
+  }
+  if (nSimulations == 0) {
+    throw std::runtime_error("No scenarios to compute the risk measure on!");
+  }
+  for (const double r : likelihoodRatios) {
+    if (r < 0.0 || !std::isfinite(r)) throw std::runtime_error("Likelihood ratios must be finite and non-negative!");
+  }
+
+  Eigen::Map<const Eigen::VectorXd> eigenWeights(weights.data(), static_cast<Eigen::Index>(nAssets));
+  const Eigen::VectorXd portfolioLosses =
+      (assetLosses * eigenWeights.template cast<Scalar>()).template cast<double>();
+
+  // Order portfolio losses in decreasing order, then walk down the tail
+  std::vector<size_t> indices(nSimulations);
+  std::iota(indices.begin(), indices.end(), size_t{0});
+  std::sort(indices.begin(), indices.end(), [&](size_t a, size_t b) {
+    return portfolioLosses(static_cast<Eigen::Index>(a)) > portfolioLosses(static_cast<Eigen::Index>(b));
+  });
+
+  // Target mass of the tail under p, in units of scenarios
+  const double tailMass = (alpha / 100.0) * static_cast<double>(nSimulations);
+
+  std::vector<double> results(nAssets + 1, 0.0);
+  double accumulated = 0.0;
+  size_t last = indices.front();
+  for (const size_t i : indices) {
+    if (likelihoodRatios[i] <= 0.0) continue;
+    last = i;
+
+    // Only the part of the boundary scenario's ratio that completes the tail counts
+    const double mass = std::min(likelihoodRatios[i], tailMass - accumulated);
+    if (measure == RiskMeasure::ES) {
+      const auto row = static_cast<Eigen::Index>(i);
+      for (size_t j = 0; j < nAssets; ++j) {
+        results[j] += mass * static_cast<double>(assetLosses(row, static_cast<Eigen::Index>(j)));
       }
+      results[nAssets] += mass * portfolioLosses(row);
+    }
+    accumulated += mass;
+    if (accumulated >= tailMass * (1.0 - 1e-12)) break;
+  }
+
+  if (measure == RiskMeasure::VaR) {
+    // The VaR is the loss at which the tail mass is reached
+    const auto row = static_cast<Eigen::Index>(last);
+    for (size_t j = 0; j < nAssets; ++j) {
+      results[j] = static_cast<double>(assetLosses(row, static_cast<Eigen::Index>(j))) * weights[j];
     }
+    results[nAssets] = portfolioLosses(row);
+  }
 
+  if (measure == RiskMeasure::ES) {
+    if (accumulated <= 0.0) {
+      throw std::runtime_error("Likelihood ratios must have a positive sum!");
+    }
+    // Falls back to the mass seen when the ratios sum to less than the tail
+    const double mass = std::min(tailMass, accumulated);
     for (size_t j = 0; j < nAssets + 1; ++j) {
-      results[j] /= static_cast<double>(nSimulations - quantileIndex);
+      results[j] /= mass;
 
       if (j < nAssets) {
         // Compute the marginal ES for each asset
@@ -107,4 +530,122 @@ std::vector<double> computePortfolioRiskMeasures(const std::vector<Eigen::Matrix
   }
 
   return results;
-}
\ No newline at end of file
+}
+
+template<typename Scalar>
+RiskSurface computeImportanceSampledRiskSurface(const LossMatrix<Scalar> &assetLosses,
+                                                const std::vector<double> &weights,
+                                                const std::vector<double> &likelihoodRatios,
+                                                const std::vector<double> &confidenceLevels) {
+  const auto nSimulations = static_cast<size_t>(assetLosses.rows());
+  const size_t nAssets = weights.size();
+  if (static_cast<size_t>(assetLosses.cols()) != nAssets) {
+    throw std::runtime_error("Asset losses and weights have different number of assets!");
+  }
+  if (likelihoodRatios.size() != nSimulations) {
+    throw std::runtime_error("Likelihood ratios and asset losses have different number of scenarios!");
+  }
+  if (nSimulations == 0) {
+    throw std::runtime_error("No scenarios to compute the risk measure on!");
+  }
+  for (const double r : likelihoodRatios) {
+    if (r < 0.0 || !std::isfinite(r)) throw std::runtime_error("Likelihood ratios must be finite and non-negative!");
+  }
+
+  RiskSurface surface;
+  surface.confidenceLevels = sortedLevels(confidenceLevels);
+  const size_t nLevels = surface.confidenceLevels.size();
+
+  Eigen::Map<const Eigen::VectorXd> eigenWeights(weights.data(), static_cast<Eigen::Index>(nAssets));
+  const Eigen::VectorXd portfolioLosses =
+      (assetLosses * eigenWeights.template cast<Scalar>()).template cast<double>();
+
+  // Same decreasing order as the single-level estimator
+  std::vector<size_t> indices(nSimulations);
+  std::iota(indices.begin(), indices.end(), size_t{0});
+  std::sort(indices.begin(), indices.end(), [&](size_t a, size_t b) {
+    return portfolioLosses(static_cast<Eigen::Index>(a)) > portfolioLosses(static_cast<Eigen::Index>(b));
+  });
+
+  Eigen::RowVectorXd eulerWeights(nAssets + 1);
+  eulerWeights.head(nAssets) = eigenWeights.transpose();
+  eulerWeights(static_cast<Eigen::Index>(nAssets)) = 1.0;
+
+  surface.VaR.resize(static_cast<Eigen::Index>(nLevels), static_cast<Eigen::Index>(nAssets + 1));
+  surface.ES.resize(static_cast<Eigen::Index>(nLevels), static_cast<Eigen::Index>(nAssets + 1));
+
+  // Walk down the losses once, accumulating ratio-weighted rows. The highest level has the
+  // smallest tail: each level closes when its mass is reached, the boundary scenario counted
+  // fractionally as in computeImportanceSampledRiskMeasures
+  Eigen::RowVectorXd row(static_cast<Eigen::Index>(nAssets + 1));
+  Eigen::RowVectorXd sum = Eigen::RowVectorXd::Zero(static_cast<Eigen::Index>(nAssets + 1));
+  double accumulated = 0.0;
+  size_t level = nLevels;
+  for (const size_t i : indices) {
+    if (level == 0) break;
+    if (likelihoodRatios[i] <= 0.0) continue;
+    row.head(nAssets) = assetLosses.row(static_cast<Eigen::Index>(i)).template cast<double>();
+    row(static_cast<Eigen::Index>(nAssets)) = portfolioLosses(static_cast<Eigen::Index>(i));
+
+    while (level > 0) {
+      const double tailMass = (1.0 - surface.confidenceLevels[level - 1]) * static_cast<double>(nSimulations);
+      const double mass = std::min(likelihoodRatios[i], tailMass - accumulated);
+      if (accumulated + mass < tailMass * (1.0 - 1e-12)) break;
+      const auto l = static_cast<Eigen::Index>(--level);
+      surface.VaR.row(l) = row.cwiseProduct(eulerWeights);
+      surface.ES.row(l) = ((sum + mass * row) / (accumulated + mass)).cwiseProduct(eulerWeights);
+    }
+    sum += likelihoodRatios[i] * row;
+    accumulated += likelihoodRatios[i];
+  }
+
+  // Ratios summing to less than a tail: that level falls back to the mass seen
+  if (level > 0) {
+    if (accumulated <= 0.0) {
+      throw std::runtime_error("Likelihood ratios must have a positive sum!");
+    }
+    for (size_t l = 0; l < level; ++l) {
+      surface.VaR.row(static_cast<Eigen::Index>(l)) = row.cwiseProduct(eulerWeights);
+      surface.ES.row(static_cast<Eigen::Index>(l)) = (sum / accumulated).cwiseProduct(eulerWeights);
+    }
+  }
+
+  return surface;
+}
+
+// Single and double precision loss matrices
+template std::vector<double> computePortfolioRiskMeasures<float>(
+    const LossMatrix<float> &, const std::vector<double> &, const size_t &, const RiskMeasure &, bool);
+template Eigen::MatrixXd computePortfolioRiskMeasuresBatch<float>(
+    const LossMatrix<float> &, const Eigen::MatrixXd &, const size_t &, const RiskMeasure &);
+template std::vector<double> computePortfolioESWithPrecision<float>(
+    const LossMatrix<float> &, const std::vector<double> &, const size_t &, const std::vector<double> &,
+    size_t, RiskPrecision &);
+template RiskSurface computePortfolioRiskSurface<float>(
+    const LossMatrix<float> &, const std::vector<double> &, const std::vector<double> &);
+template std::vector<double> computeWeightedPortfolioRiskMeasures<float>(
+    const LossMatrix<float> &, const std::vector<double> &, const std::vector<double> &,
+    const size_t &, const RiskMeasure &);
+template std::vector<double> computeImportanceSampledRiskMeasures<float>(
+    const LossMatrix<float> &, const std::vector<double> &, const std::vector<double> &,
+    const size_t &, const RiskMeasure &);
+template RiskSurface computeImportanceSampledRiskSurface<float>(
+    const LossMatrix<float> &, const std::vector<double> &, const std::vector<double> &, const std::vector<double> &);
+
+template std::vector<double> computePortfolioRiskMeasures<double>(
+    const LossMatrix<double> &, const std::vector<double> &, const size_t &, const RiskMeasure &, bool);
+template Eigen::MatrixXd computePortfolioRiskMeasuresBatch<double>(
+    const LossMatrix<double> &, const Eigen::MatrixXd &, const size_t &, const RiskMeasure &);
+template std::vector<double> computePortfolioESWithPrecision<double>(
+    const LossMatrix<double> &, const std::vector<double> &, const size_t &, const std::vector<double> &,
+    size_t, RiskPrecision &);
+template RiskSurface computePortfolioRiskSurface<double>(
+    const LossMatrix<double> &, const std::vector<double> &, const std::vector<double> &);
+template std::vector<double> computeWeightedPortfolioRiskMeasures<double>(
+    const LossMatrix<double> &, const std::vector<double> &, const std::vector<double> &,
+    const size_t &, const RiskMeasure &);
+template std::vector<double> computeImportanceSampledRiskMeasures<double>(
+    const LossMatrix<double> &, const std::vector<double> &, const std::vector<double> &,
+    const size_t &, const RiskMeasure &);
+template RiskSurface computeImportanceSampledRiskSurface<double>(
+    const LossMatrix<double> &, const std::vector<double> &, const std::vector<double> &, const std::vector<double> &);
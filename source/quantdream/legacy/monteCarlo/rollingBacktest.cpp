@@ -0,0 +1,153 @@
+//
+// Created by user on 10/15/26.
+//
+
+#include "quantdream/legacy/monteCarlo/rollingBacktest.h"
+#include "quantdream/core/parallel/thread_pool.h"
+
+#include <algorithm>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+template<typename Scalar>
+BasicRollingBacktest<Scalar>::BasicRollingBacktest(YFData data, RollingBacktestOptions options)
+    : data_(std::move(data)),
+      options_(std::move(options)) {
+  if (data_.empty()) {
+    throw std::runtime_error("RollingBacktest: market data is empty!");
+  }
+  if (options_.nChains == 0) {
+    throw std::runtime_error("RollingBacktest: at least one chain is needed!");
+  }
+}
+
+template<typename Scalar>
+void BasicRollingBacktest<Scalar>::setRiskBudgets(const std::vector<double> &budgets) {
+  budgets_ = budgets;
+}
+
+template<typename Scalar>
+void BasicRollingBacktest<Scalar>::setRiskBudgetSchedule(std::map<std::string, std::vector<double>> schedule) {
+  schedule_ = std::move(schedule);
+}
+
+template<typename Scalar>
+const std::vector<double> &BasicRollingBacktest<Scalar>::budgetsAt_(const std::string &date) const {
+  auto it = schedule_.upper_bound(date);
+  if (it == schedule_.begin()) return budgets_;
+  return std::prev(it)->second;
+}
+
+template<typename Scalar>
+YFData BasicRollingBacktest<Scalar>::slice_(const std::string &after, const std::string &upTo) const {
+  YFData slice;
+  for (auto it = data_.upper_bound(after); it != data_.end() && it->first <= upTo; ++it) {
+    slice.emplace_hint(slice.end(), it->first, it->second);
+  }
+  return slice;
+}
+
+template<typename Scalar>
+std::vector<std::string> BasicRollingBacktest<Scalar>::monthEnds() const {
+  std::vector<std::string> dates;
+  for (auto it = data_.begin(); it != data_.end(); ++it) {
+    const auto next = std::next(it);
+    // YYYY-MM is the first seven characters
+    if (next == data_.end() || next->first.compare(0, 7, it->first, 0, 7) != 0) dates.push_back(it->first);
+  }
+  return dates;
+}
+
+template<typename Scalar>
+std::vector<RollingRebalance> BasicRollingBacktest<Scalar>::runChain_(const std::vector<std::string> &dates,
+                                                                      const size_t first,
+                                                                      const size_t last,
+                                                                      const size_t nThreads) const {
+  std::vector<RollingRebalance> results;
+  std::optional<BasicMonteCarloEngine<Scalar>> mc;
+  std::vector<double> previous;
+
+  for (size_t k = first; k < last; ++k) {
+    const std::string &date = dates[k];
+
+    // --- the returns window up to the date: built once, then extended ---
+    if (!mc) {
+      const YFData window = slice_("", date);
+      if (window.size() < 2) continue;
+      mc.emplace(window, options_.nSimulations, options_.nSamples, options_.blockSize, options_.alpha);
+      mc->selectCategory(options_.category);
+      mc->setNumThreads(nThreads);
+    } else {
+      mc->extendData(slice_(mc->getLastDate(), date));
+    }
+    if (mc->getNumReturns() < options_.minHistory) continue;
+
+    // --- warm start from the previous date, or cold from covariance risk parity ---
+    const std::vector<double> &budgets = budgetsAt_(date);
+    const size_t nAssets = mc->getAvailableTickers().size();
+    BasicERCOptimizer<Scalar> optimizer(*mc, nAssets, options_.maxIterations, options_.method,
+                                        options_.param1, options_.param2);
+    optimizer.setSolver(options_.solver);
+    optimizer.setCommonRandomNumbers(options_.commonRandomNumbers);
+    optimizer.setRiskBudgets(budgets);
+    const bool warmStarted = previous.size() == nAssets;
+    optimizer.setInitialWeights(warmStarted ? previous : mc->solveCovarianceRiskParity(1e-12, 100, budgets));
+
+    mc->setSeed(options_.seed + k);
+    previous = optimizer.optimize(options_.tol, options_.eps_rc, options_.damping, false);
+
+    RollingRebalance rebalance;
+    rebalance.date = date;
+    rebalance.weights = previous;
+    rebalance.ES = mc->getPortfolioLoss();
+    rebalance.nReturns = mc->getNumReturns();
+    rebalance.warmStarted = warmStarted;
+    rebalance.iterations = optimizer.getIterations();
+    results.push_back(std::move(rebalance));
+  }
+  return results;
+}
+
+template<typename Scalar>
+std::vector<RollingRebalance> BasicRollingBacktest<Scalar>::run(const std::vector<std::string> &dates) const {
+  std::vector<std::string> grid = dates;
+  std::sort(grid.begin(), grid.end());
+  grid.erase(std::unique(grid.begin(), grid.end()), grid.end());
+
+  // Dates that cannot have minHistory returns yet would leave the first chains idle
+  grid.erase(std::remove_if(grid.begin(), grid.end(), [this](const std::string &date) {
+    const auto nDates = static_cast<size_t>(std::distance(data_.begin(), data_.upper_bound(date)));
+    return nDates < std::max<size_t>(options_.minHistory, 1) + 1;
+  }), grid.end());
+  if (grid.empty()) return {};
+
+  size_t nThreads = options_.nThreads > 0 ? options_.nThreads : std::thread::hardware_concurrency();
+  if (nThreads == 0) nThreads = 1;
+  const size_t nChains = std::min(options_.nChains, grid.size());
+
+  // Contiguous runs of dates, one warm-start chain each. The chains and the simulations inside
+  // them share the pool, so every engine may cut its paths into nThreads chunks: a chain that
+  // finishes early leaves its workers to the simulations of the others
+  const size_t chunk = (grid.size() + nChains - 1) / nChains;
+  std::vector<std::vector<RollingRebalance>> chains((grid.size() + chunk - 1) / chunk);
+  qd::parallel::TaskGroup group;
+  for (size_t c = 0; c < chains.size(); ++c) {
+    const size_t first = c * chunk;
+    const size_t last = std::min(grid.size(), first + chunk);
+    group.run([this, &grid, &chains, c, first, last, nThreads]() {
+      chains[c] = runChain_(grid, first, last, nThreads);
+    });
+  }
+  // wait() rethrows any exception raised inside a chain
+  group.wait();
+
+  std::vector<RollingRebalance> results;
+  for (auto &chain : chains) std::move(chain.begin(), chain.end(), std::back_inserter(results));
+  return results;
+}
+
+template class BasicRollingBacktest<float>;
+template class BasicRollingBacktest<double>;
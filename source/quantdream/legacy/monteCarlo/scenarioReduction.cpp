@@ -0,0 +1,242 @@
+//
+// Created by user on 10/15/26.
+//
+
+#include "quantdream/legacy/monteCarlo/scenarioReduction.h"
+#include "quantdream/core/parallel/thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+// Rows per block of the distance products
+constexpr Eigen::Index kAssignBlock = 256;
+// Scale of the reference loss appended to the per-asset losses before clustering
+constexpr double kReferenceEmphasis = 3.0;
+
+// k-medoids on the rows of a region, ordered by reference loss: seeds evenly spaced along that
+// order, then alternate nearest-medoid assignment (in nThreads chunks on the shared pool) and, in every cluster,
+// the member nearest to the mass-weighted centroid. Returns the medoid rows and the cluster masses
+std::vector<size_t> kMedoids(const BasicReturnsMatrix<double> &rows,
+                             const std::vector<double> &masses,
+                             const size_t nClusters,
+                             const size_t nThreads,
+                             const size_t maxIterations,
+                             std::vector<double> &clusterMass) {
+  const auto n = static_cast<size_t>(rows.rows());
+  const auto nAssets = rows.cols();
+  const size_t k = std::min(nClusters, n);
+
+  std::vector<size_t> medoids(k);
+  for (size_t c = 0; c < k; ++c) medoids[c] = (2 * c + 1) * n / (2 * k);
+  if (k == n) {
+    std::iota(medoids.begin(), medoids.end(), size_t{0});
+    clusterMass = masses;
+    return medoids;
+  }
+
+  std::vector<size_t> assignment(n, k);
+  BasicReturnsMatrix<double> centres(static_cast<Eigen::Index>(k), nAssets);
+
+  // Nearest medoid of every row. Returns whether any assignment changed
+  auto assign = [&]() {
+    for (size_t c = 0; c < k; ++c) {
+      centres.row(static_cast<Eigen::Index>(c)) = rows.row(static_cast<Eigen::Index>(medoids[c]));
+    }
+    const Eigen::RowVectorXd centreNorms = centres.rowwise().squaredNorm().transpose();
+
+    std::vector<char> changed(n, 0);
+    qd::parallel::ThreadPool::global().parallel_for(n, nThreads, [&](const size_t first, const size_t last) {
+      // ||x - c||^2 = ||x||^2 - 2 x.c + ||c||^2, and ||x||^2 does not change the argmin
+      BasicReturnsMatrix<double> products;
+      for (auto start = static_cast<Eigen::Index>(first); start < static_cast<Eigen::Index>(last);
+           start += kAssignBlock) {
+        const Eigen::Index block = std::min(kAssignBlock, static_cast<Eigen::Index>(last) - start);
+        products.noalias() = rows.middleRows(start, block) * centres.transpose();
+        for (Eigen::Index r = 0; r < block; ++r) {
+          Eigen::Index best;
+          (centreNorms - 2.0 * products.row(r)).minCoeff(&best);
+          const auto i = static_cast<size_t>(start + r);
+          if (assignment[i] != static_cast<size_t>(best)) {
+            assignment[i] = static_cast<size_t>(best);
+            changed[i] = 1;
+          }
+        }
+      }
+    });
+    return std::any_of(changed.begin(), changed.end(), [](const char c) { return c != 0; });
+  };
+
+  auto accumulate = [&](Eigen::MatrixXd &centroids) {
+    centroids.setZero(static_cast<Eigen::Index>(k), nAssets);
+    clusterMass.assign(k, 0.0);
+    for (size_t i = 0; i < n; ++i) {
+      centroids.row(static_cast<Eigen::Index>(assignment[i])) += masses[i] * rows.row(static_cast<Eigen::Index>(i));
+      clusterMass[assignment[i]] += masses[i];
+    }
+  };
+
+  Eigen::MatrixXd centroids;
+  assign();
+  for (size_t iter = 0; iter < maxIterations; ++iter) {
+    accumulate(centroids);
+    for (size_t c = 0; c < k; ++c) {
+      if (clusterMass[c] > 0.0) centroids.row(static_cast<Eigen::Index>(c)) /= clusterMass[c];
+    }
+
+    std::vector<double> bestDistance(k, std::numeric_limits<double>::infinity());
+    for (size_t i = 0; i < n; ++i) {
+      const size_t c = assignment[i];
+      if (clusterMass[c] <= 0.0) continue;
+      const double distance =
+          (rows.row(static_cast<Eigen::Index>(i)) - centroids.row(static_cast<Eigen::Index>(c))).squaredNorm();
+      if (distance < bestDistance[c]) {
+        bestDistance[c] = distance;
+        medoids[c] = i;
+      }
+    }
+    if (!assign()) break;
+  }
+
+  accumulate(centroids);
+  return medoids;
+}
+
+double relativeError(const double reduced, const double full) {
+  const double error = std::abs(reduced - full);
+  return full != 0.0 ? error / std::abs(full) : error;
+}
+
+}  // namespace
+
+template<typename Scalar>
+ScenarioReduction reduceScenarios(const LossMatrix<Scalar> &assetLosses,
+                                  const size_t nReduced,
+                                  const std::vector<double> &referenceWeights,
+                                  const size_t alpha,
+                                  const std::vector<double> &scenarioMasses,
+                                  const size_t nThreads,
+                                  const size_t maxIterations) {
+  const auto nScenarios = static_cast<size_t>(assetLosses.rows());
+  const auto nAssets = assetLosses.cols();
+  if (nScenarios == 0) {
+    throw std::runtime_error("No scenarios to reduce!");
+  }
+  if (nReduced < 2) {
+    throw std::runtime_error("The reduced scenario set needs at least two scenarios (tail and body)!");
+  }
+  if (referenceWeights.size() != static_cast<size_t>(nAssets)) {
+    throw std::runtime_error("Asset losses and weights have different number of assets!");
+  }
+  if (!scenarioMasses.empty() && scenarioMasses.size() != nScenarios) {
+    throw std::runtime_error("Scenario masses and asset losses have different number of scenarios!");
+  }
+
+  // Normalised scenario probabilities
+  std::vector<double> masses = scenarioMasses;
+  if (masses.empty()) masses.assign(nScenarios, 1.0);
+  double totalMass = 0.0;
+  for (const double m : masses) {
+    if (m < 0.0) throw std::runtime_error("Scenario masses must be non-negative!");
+    totalMass += m;
+  }
+  if (totalMass <= 0.0) {
+    throw std::runtime_error("Scenario masses must have a positive sum!");
+  }
+  for (double &m : masses) m /= totalMass;
+
+  ScenarioReduction result;
+  if (nReduced >= nScenarios) {
+    result.scenarios.resize(nScenarios);
+    std::iota(result.scenarios.begin(), result.scenarios.end(), size_t{0});
+    result.weights = masses;
+    result.VaRError = result.ESError = result.assetESError = 0.0;
+    return result;
+  }
+
+  const Eigen::MatrixXd losses = assetLosses.template cast<double>();
+  Eigen::Map<const Eigen::VectorXd> w(referenceWeights.data(), nAssets);
+  const Eigen::VectorXd portfolioLosses = losses * w;
+  const double weightNorm = std::max(w.norm(), 1e-300);
+
+  // Scenarios from the worst reference loss down
+  std::vector<size_t> order(nScenarios);
+  std::iota(order.begin(), order.end(), size_t{0});
+  std::sort(order.begin(), order.end(), [&](const size_t a, const size_t b) {
+    const double la = portfolioLosses(static_cast<Eigen::Index>(a));
+    const double lb = portfolioLosses(static_cast<Eigen::Index>(b));
+    return la > lb || (la == lb && a < b);
+  });
+
+  // --- Tail and body, clustered separately ---
+  const double tailMass = std::min(1.0, 2.0 * static_cast<double>(alpha) / 100.0);
+  size_t nTail = 0;
+  double keptMass = 0.0;
+  while (nTail < nScenarios && keptMass < tailMass * (1.0 - 1e-12)) keptMass += masses[order[nTail++]];
+  if (nTail == nScenarios) nTail = nScenarios - 1;
+
+  const size_t nTailClusters = std::min(nTail, nReduced / 2);
+  const size_t nBodyClusters = nReduced - nTailClusters;
+
+  auto cluster = [&](const size_t first, const size_t last, const size_t nClusters) {
+    const std::vector<size_t> region(order.begin() + static_cast<std::ptrdiff_t>(first),
+                                     order.begin() + static_cast<std::ptrdiff_t>(last));
+    // Clustering mixes scenarios and so shrinks the tail (the ES is convex): the reference loss,
+    // as an extra coordinate, keeps clusters thin along the direction that ranks the tail
+    BasicReturnsMatrix<double> rows(static_cast<Eigen::Index>(region.size()), nAssets + 1);
+    std::vector<double> regionMasses(region.size());
+    for (size_t i = 0; i < region.size(); ++i) {
+      const auto row = static_cast<Eigen::Index>(i);
+      rows.row(row).head(nAssets) = losses.row(static_cast<Eigen::Index>(region[i]));
+      rows(row, nAssets) = kReferenceEmphasis * portfolioLosses(static_cast<Eigen::Index>(region[i])) / weightNorm;
+      regionMasses[i] = masses[region[i]];
+    }
+
+    std::vector<double> clusterMass;
+    const std::vector<size_t> medoids = kMedoids(rows, regionMasses, nClusters, nThreads, maxIterations, clusterMass);
+    for (size_t c = 0; c < medoids.size(); ++c) {
+      if (clusterMass[c] <= 0.0) continue;
+      result.scenarios.push_back(region[medoids[c]]);
+      result.weights.push_back(clusterMass[c]);
+    }
+  };
+  cluster(0, nTail, nTailClusters);
+  cluster(nTail, nScenarios, nBodyClusters);
+
+  // --- Error of the reduced set ---
+  LossMatrix<Scalar> reduced(static_cast<Eigen::Index>(result.scenarios.size()), nAssets);
+  for (size_t k = 0; k < result.scenarios.size(); ++k) {
+    reduced.row(static_cast<Eigen::Index>(k)) = assetLosses.row(static_cast<Eigen::Index>(result.scenarios[k]));
+  }
+
+  auto measure = [&](const LossMatrix<Scalar> &set, const std::vector<double> &probabilities,
+                     const std::vector<double> &weights, const RiskMeasure riskMeasure) {
+    return computeWeightedPortfolioRiskMeasures(set, weights, probabilities, alpha, riskMeasure).back();
+  };
+  result.VaRError = relativeError(measure(reduced, result.weights, referenceWeights, RiskMeasure::VaR),
+                                  measure(assetLosses, masses, referenceWeights, RiskMeasure::VaR));
+  result.ESError = relativeError(measure(reduced, result.weights, referenceWeights, RiskMeasure::ES),
+                                 measure(assetLosses, masses, referenceWeights, RiskMeasure::ES));
+
+  result.assetESError = 0.0;
+  std::vector<double> single(static_cast<size_t>(nAssets), 0.0);
+  for (Eigen::Index j = 0; j < nAssets; ++j) {
+    single[static_cast<size_t>(j)] = 1.0;
+    result.assetESError = std::max(result.assetESError,
+                                   relativeError(measure(reduced, result.weights, single, RiskMeasure::ES),
+                                                 measure(assetLosses, masses, single, RiskMeasure::ES)));
+    single[static_cast<size_t>(j)] = 0.0;
+  }
+
+  return result;
+}
+
+template ScenarioReduction reduceScenarios<float>(const LossMatrix<float> &, size_t, const std::vector<double> &,
+                                                  size_t, const std::vector<double> &, size_t, size_t);
+template ScenarioReduction reduceScenarios<double>(const LossMatrix<double> &, size_t, const std::vector<double> &,
+                                                   size_t, const std::vector<double> &, size_t, size_t);
@@ -0,0 +1,132 @@
+//
+// Created by user on 10/15/26.
+//
+
+#include "quantdream/legacy/monteCarlo/tailAccumulator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+// Strict ranking of scenarios from the worst down: by loss, then by scenario index
+bool ranksAbove(const double lossA, const size_t scenarioA, const double lossB, const size_t scenarioB) {
+  return lossA > lossB || (lossA == lossB && scenarioA > scenarioB);
+}
+
+}  // namespace
+
+TailAccumulator::TailAccumulator(const size_t nAssets, const size_t nScenarios, const size_t alpha)
+    : nAssets_(nAssets),
+      nScenarios_(nScenarios),
+      alpha_(alpha) {
+  if (nScenarios == 0) {
+    throw std::runtime_error("TailAccumulator: the scenario set must not be empty!");
+  }
+
+  capacity_ = tailSize_(nScenarios);
+  heap_.reserve(capacity_);
+  rows_.resize(static_cast<Eigen::Index>(capacity_), static_cast<Eigen::Index>(nAssets));
+}
+
+size_t TailAccumulator::tailSize_(const size_t n) const {
+  auto quantileIndex = static_cast<size_t>(std::floor((1 - alpha_ / 100.0) * n));
+  if (quantileIndex >= n) quantileIndex = n - 1;
+  return n - quantileIndex;
+}
+
+bool TailAccumulator::add(const size_t scenario,
+                          const double portfolioLoss,
+                          const Eigen::Ref<const Eigen::RowVectorXd> &assetLosses) {
+  if (static_cast<size_t>(assetLosses.size()) != nAssets_) {
+    throw std::runtime_error("TailAccumulator: asset losses have the wrong number of assets!");
+  }
+
+  ++count_;
+  return insert_(scenario, portfolioLoss, assetLosses);
+}
+
+bool TailAccumulator::insert_(const size_t scenario,
+                              const double portfolioLoss,
+                              const Eigen::Ref<const Eigen::RowVectorXd> &assetLosses) {
+  const auto minHeap = [](const Entry &a, const Entry &b) {
+    return ranksAbove(a.loss, a.scenario, b.loss, b.scenario);
+  };
+
+  if (heap_.size() < capacity_) {
+    const auto slot = static_cast<Eigen::Index>(heap_.size());
+    rows_.row(slot) = assetLosses;
+    heap_.push_back({portfolioLoss, scenario, slot});
+    std::push_heap(heap_.begin(), heap_.end(), minHeap);
+    return true;
+  }
+
+  // Full: the scenario replaces the mildest one kept, if it ranks above it
+  const Entry &mildest = heap_.front();
+  if (!ranksAbove(portfolioLoss, scenario, mildest.loss, mildest.scenario)) return false;
+
+  std::pop_heap(heap_.begin(), heap_.end(), minHeap);
+  Entry &freed = heap_.back();
+  rows_.row(freed.slot) = assetLosses;
+  freed.loss = portfolioLoss;
+  freed.scenario = scenario;
+  std::push_heap(heap_.begin(), heap_.end(), minHeap);
+  return true;
+}
+
+void TailAccumulator::merge(const TailAccumulator &other) {
+  if (other.nAssets_ != nAssets_ || other.nScenarios_ != nScenarios_ || other.alpha_ != alpha_) {
+    throw std::runtime_error("TailAccumulator: cannot merge accumulators of different scenario sets!");
+  }
+
+  for (const Entry &entry : other.heap_) {
+    insert_(entry.scenario, entry.loss, other.rows_.row(entry.slot));
+  }
+  count_ += other.count_;
+}
+
+std::vector<double> TailAccumulator::riskMeasures(const std::vector<double> &weights,
+                                                  const RiskMeasure measure) const {
+  if (weights.size() != nAssets_) {
+    throw std::runtime_error("Asset losses and weights have different number of assets!");
+  }
+  if (count_ == 0) {
+    throw std::runtime_error("No scenarios to compute the risk measure on!");
+  }
+
+  // Worst scenarios first; the tail of the scenarios seen so far is a prefix of them
+  std::vector<Entry> tail = heap_;
+  std::sort(tail.begin(), tail.end(), [](const Entry &a, const Entry &b) {
+    return ranksAbove(a.loss, a.scenario, b.loss, b.scenario);
+  });
+  tail.resize(std::min(tail.size(), tailSize_(count_)));
+
+  std::vector<double> results(nAssets_ + 1, 0.0);
+  if (measure == RiskMeasure::VaR) {
+    // The VaR is the smallest loss in the tail
+    const Entry &quantile = tail.back();
+    for (size_t j = 0; j < nAssets_; ++j) {
+      results[j] = rows_(quantile.slot, static_cast<Eigen::Index>(j)) * weights[j];
+    }
+    results[nAssets_] = quantile.loss;
+  }
+
+  if (measure == RiskMeasure::ES) {
+    // Summed in rank order, so that the result does not depend on the arrival order
+    Eigen::RowVectorXd assetSum = Eigen::RowVectorXd::Zero(static_cast<Eigen::Index>(nAssets_));
+    for (const Entry &entry : tail) {
+      assetSum += rows_.row(entry.slot);
+      results[nAssets_] += entry.loss;
+    }
+
+    for (size_t j = 0; j < nAssets_; ++j) {
+      // Compute the marginal ES for each asset
+      results[j] = assetSum(static_cast<Eigen::Index>(j)) / static_cast<double>(tail.size()) * weights[j];
+    }
+    results[nAssets_] /= static_cast<double>(tail.size());
+  }
+
+  return results;
+}
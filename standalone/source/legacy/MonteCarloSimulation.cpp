@@ -73,6 +73,15 @@ int main() {
     auto rc = mc.computeRiskContributions(RiskMeasure::ES, true);
     std::cout << "Vanilla Portfolio Expected Shortfall (ES): " << mc.getPortfolioLoss() << "\n";
 
+    // VaR and ES at every reporting level from the same scenarios
+    const RiskSurface surface = mc.computeRiskSurface();
+    for (size_t l = 0; l < surface.confidenceLevels.size(); ++l) {
+      const auto level = static_cast<Eigen::Index>(l);
+      std::cout << "  " << 100.0 * surface.confidenceLevels[l] << "%"
+                << "\tVaR: " << surface.VaR(level, surface.VaR.cols() - 1)
+                << "\tES: " << surface.ES(level, surface.ES.cols() - 1) << "\n";
+    }
+
     // Lambda-bias case
     mc.runSimulation(SimulationMethod::LambdaBias, lambdaBias, 0.0);
     rc = mc.computeRiskContributions(RiskMeasure::ES, true);
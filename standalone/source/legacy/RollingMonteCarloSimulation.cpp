@@ -18,6 +18,7 @@
 
 #include "quantdream/legacy/csvReader/CsvReader.h"
 #include "quantdream/legacy/monteCarlo/engine.h"
+#include "quantdream/core/parallel/thread_pool.h"
 
 // Data structure used to store Yahoo Finance data
 // The first level is the date, the second is the category (like Close, Open, etc.),
@@ -113,11 +114,12 @@ void runProgressiveERC(const YFData& data, bool verbose) {
               << std::setw(5) << (frac * 100) << "% of dataset ("
               << cutoff << " samples)\n";
 
-    // Create asynchronous jobs for each thread
+    // Submit one job per engine to the shared pool. The engines' own parallel loops run on
+    // the same workers, so the sweep does not oversubscribe the cores
     std::vector<std::future<std::map<std::string, std::vector<double>>>> futures;
 
     for (size_t t = 0; t < nThreads; ++t) {
-      futures.emplace_back(std::async(std::launch::async, [&, t]() {
+      futures.emplace_back(qd::parallel::ThreadPool::global().submit([&, t]() {
         MonteCarloEngine mc(sliced_data, nSimulations, nSamples, blockSize, alpha);
         mc.setSeed(std::random_device{}() + t);
         mc.selectCategory("Close");
@@ -250,23 +250,22 @@ struct MCResult {
 
 // -----------------------------------------------------------
 // Compute average path + store ALL returns for metrics
+// Scenarios come from the engine's last run, so every weight vector
+// is evaluated on the same set of paths
 // -----------------------------------------------------------
-MCResult compute_average_path_and_returns(MonteCarloEngine &mc,
+MCResult compute_average_path_and_returns(const MonteCarloEngine &mc,
                                         const std::vector<double> &weights,
-                                        size_t nSim, size_t blockSize,
+                                        size_t nSim,
                                         bool compounded) {
   std::vector<Eigen::VectorXd> paths;
   paths.reserve(nSim);
   std::vector<Eigen::VectorXd> returns_all;
   returns_all.reserve(nSim);
 
-  Eigen::Map<const Eigen::VectorXd> w(weights.data(), weights.size());
-
   for (size_t s = 0; s < nSim; ++s) {
-      Eigen::MatrixXd sim = mc.runSingleSimulationVanilla(blockSize);
-      if (sim.rows() == 0) continue;
-
-      Eigen::VectorXd ret = sim * w;  // daily portfolio returns for THIS simulation
+      // daily portfolio returns for THIS simulation, assembled from its blocks
+      Eigen::VectorXd ret = mc.scenarioPortfolioReturns(s, weights);
+      if (ret.size() == 0) continue;
       returns_all.push_back(ret);
 
       Eigen::VectorXd cum = compounded ? cumulative_compounded(ret)
@@ -328,15 +327,20 @@ int main() {
       MonteCarloEngine mc(data, nSim, nSamples, blockSize, 5);
       mc.selectCategory("Close");
 
+      // Keep only the block lists of each path: rows are read on demand
+      mc.setScenarioStorage(ScenarioStorage::Compact);
+      mc.runSimulation(SimulationMethod::Vanilla, blockSize);
+
       const size_t nAssets = 6;
       std::vector<double> w_equal(nAssets, 1.0 / nAssets);
       std::vector<double> w_custom = {0.12, 0.10, 0.28, 0.27, 0.11, 0.12};
 
       // === Run simulations (COMP and SIMPLE), storing cumulative paths AND returns ===
-      MCResult eqComp    = compute_average_path_and_returns(mc, w_equal, nSim, blockSize, true);
-      MCResult cuComp    = compute_average_path_and_returns(mc, w_custom, nSim, blockSize, true);
-      MCResult eqSimple  = compute_average_path_and_returns(mc, w_equal, nSim, blockSize, false);
-      MCResult cuSimple  = compute_average_path_and_returns(mc, w_custom, nSim, blockSize, false);
+      // Both portfolios share one scenario set on purpose: their difference is not blurred by independent draws
+      MCResult eqComp    = compute_average_path_and_returns(mc, w_equal, nSim, true);
+      MCResult cuComp    = compute_average_path_and_returns(mc, w_custom, nSim, true);
+      MCResult eqSimple  = compute_average_path_and_returns(mc, w_equal, nSim, false);
+      MCResult cuSimple  = compute_average_path_and_returns(mc, w_custom, nSim, false);
 
       // === Worst α% by cumulative final value ===
       MCResult eqCompWorst    = compute_tail_average(eqComp.allPaths, alpha);
@@ -413,6 +417,20 @@ int main() {
       std::cout << "\nRisk-free rate (annual): " << std::fixed << std::setprecision(2)
                 << riskFreeRate * 100.0 << "%\n";
 
+      // === Horizon VaR / ES of both portfolios on the same scenarios (one GEMM) ===
+      Eigen::MatrixXd candidates(nAssets, 2);
+      candidates.col(0) = Eigen::Map<const Eigen::VectorXd>(w_equal.data(), nAssets);
+      candidates.col(1) = Eigen::Map<const Eigen::VectorXd>(w_custom.data(), nAssets);
+      const Eigen::MatrixXd horizonVaR = mc.computeRiskContributionsBatch(RiskMeasure::VaR, candidates);
+      const Eigen::MatrixXd horizonES  = mc.computeRiskContributionsBatch(RiskMeasure::ES, candidates);
+
+      std::cout << "\n=== Horizon Risk (" << nSamples << " days, alpha = 5%) ===\n";
+      std::cout << std::fixed << std::setprecision(6);
+      std::cout << std::left << std::setw(20) << "Equal-weighted"  << "VaR: " << std::setw(12) << horizonVaR(0, nAssets)
+                << "ES: " << horizonES(0, nAssets) << "\n";
+      std::cout << std::left << std::setw(20) << "Custom-weighted" << "VaR: " << std::setw(12) << horizonVaR(1, nAssets)
+                << "ES: " << horizonES(1, nAssets) << "\n";
+
 
       // === Plot: compounded cumulative returns (Full vs Worst) ===
       plot_full_vs_worst(eqComp.mean,   eqComp.mean   + sigmaFactor * eqComp.stddev,   eqComp.mean   - sigmaFactor * eqComp.stddev,
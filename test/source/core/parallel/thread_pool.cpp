@@ -0,0 +1,111 @@
+//
+// Created by user on 10/15/26.
+//
+
+#include <atomic>
+#include <cstddef>
+#include <future>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "quantdream/core/parallel/thread_pool.h"
+
+int main() {
+  /** Example usage of the work-stealing thread pool
+   * parallel_for cuts a range into chunks run on the pool; waiting threads run queued tasks,
+   * so loops nested inside pool tasks share the same workers instead of adding threads.
+   */
+
+  // -------------------------------------------------------
+  // Parameters
+  // -------------------------------------------------------
+  const size_t nThreads = 4;
+  const size_t n = 1000000;
+  const size_t nOuter = 16;
+
+  qd::parallel::ThreadPool pool(nThreads);
+  bool ok = true;
+
+  // -------------------------------------------------------
+  // Example 1: parallel_for over a range, one partial sum per chunk
+  // -------------------------------------------------------
+  std::vector<double> data(n);
+  std::iota(data.begin(), data.end(), 1.0);
+
+  const size_t nChunks = 64;
+  std::vector<double> partial(nChunks, 0.0);
+  const size_t chunk = (n + nChunks - 1) / nChunks;
+  pool.parallel_for(n, nChunks, [&](const size_t first, const size_t last) {
+    double sum = 0.0;
+    for (size_t i = first; i < last; ++i) sum += data[i];
+    partial[first / chunk] = sum;
+  });
+  const double sum = std::accumulate(partial.begin(), partial.end(), 0.0);
+  const double expected = 0.5 * static_cast<double>(n) * static_cast<double>(n + 1);
+  std::cout << "parallel_for sum: " << sum << " (expected " << expected << ")\n";
+  ok = ok && sum == expected;
+
+  // -------------------------------------------------------
+  // Example 2: a parallel sweep of parallel loops on the same pool
+  // -------------------------------------------------------
+  std::atomic<size_t> visited{0};
+  pool.parallel_for(nOuter, nOuter, [&](const size_t first, const size_t last) {
+    for (size_t k = first; k < last; ++k) {
+      pool.parallel_for(n / 100, nThreads, [&](const size_t a, const size_t b) { visited += b - a; });
+    }
+  });
+  std::cout << "Nested loops visited: " << visited.load() << " (expected " << nOuter * (n / 100) << ")\n";
+  ok = ok && visited.load() == nOuter * (n / 100);
+
+  // -------------------------------------------------------
+  // Example 3: submit a task and read its result from a future
+  // -------------------------------------------------------
+  auto future = pool.submit([]() { return 6 * 7; });
+  const int answer = future.get();
+  std::cout << "Submitted task returned: " << answer << "\n";
+  ok = ok && answer == 42;
+
+  // -------------------------------------------------------
+  // Example 4: an exception in a chunk is rethrown by parallel_for
+  // -------------------------------------------------------
+  bool caught = false;
+  try {
+    pool.parallel_for(100, 10, [](const size_t first, const size_t) {
+      if (first == 50) throw std::runtime_error("chunk failed");
+    });
+  } catch (const std::runtime_error &ex) {
+    caught = true;
+    std::cout << "Exception rethrown: " << ex.what() << "\n";
+  }
+  ok = ok && caught;
+
+  // -------------------------------------------------------
+  // Example 5: waiting on a group never runs another group's task
+  // -------------------------------------------------------
+  // One worker, held until the wait is over, and an unrelated task queued before the group's:
+  // the waiting thread must run its own task and leave the other one to the worker
+  qd::parallel::ThreadPool single(1);
+  std::promise<void> release;
+  std::shared_future<void> gate = release.get_future().share();
+  auto blocker = single.submit([gate]() { gate.wait(); });
+  const std::thread::id caller = std::this_thread::get_id();
+  std::atomic<bool> unrelatedOnCaller{false};
+  auto unrelated = single.submit([&]() { unrelatedOnCaller = std::this_thread::get_id() == caller; });
+
+  bool ownRan = false;
+  qd::parallel::TaskGroup group(single);
+  group.run([&]() { ownRan = true; });
+  group.wait();
+  release.set_value();
+  blocker.get();
+  unrelated.get();
+  std::cout << "Group task ran: " << (ownRan ? "yes" : "no")
+            << ", unrelated task ran on the waiting thread: " << (unrelatedOnCaller ? "yes" : "no") << "\n";
+  ok = ok && ownRan && !unrelatedOnCaller;
+
+  std::cout << "All checks passed: " << (ok ? "yes" : "no") << std::endl;
+  return ok ? 0 : 1;
+}
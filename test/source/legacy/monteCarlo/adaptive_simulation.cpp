@@ -0,0 +1,100 @@
+//
+// Created by user on 10/15/26.
+//
+
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "quantdream/legacy/monteCarlo/engine.h"
+#include "syntheticData.h"
+
+int main() {
+  /** Example of usage of the adaptive simulation
+   * Batches of paths are added to one run until the ES confidence interval is narrow enough.
+   * The run must stop with the half-width under its target, a tighter target must need more
+   * batches, and the paths drawn must be those of runSimulation() over as many paths.
+   */
+
+  // -------------------------------------------------------
+  // Parameters
+  // -------------------------------------------------------
+  const YFData data = makeSyntheticData(600, 4);
+  const size_t nSamples = 60;
+  const size_t blockSize = 5;
+  const size_t alpha = 5;
+  const std::vector<double> weights = {0.4, 0.3, 0.2, 0.1};
+
+  int failures = 0;
+
+  auto makeEngine = [&]() {
+    MonteCarloEngine mc(data, 1000, nSamples, blockSize, alpha);
+    mc.selectCategory("Close");
+    mc.setSeed(42);
+    mc.setNumThreads(4);
+    mc.setScenarioStorage(ScenarioStorage::Losses);
+    mc.setWeights(weights);
+    return mc;
+  };
+
+  // Run to a target, then redo the same paths with runSimulation() and compare the ES
+  auto runToTarget = [&](const std::string &name, const SimulationMethod method, const double param2,
+                         const bool importanceSampling, const double target) {
+    AdaptiveOptions options;
+    options.relativeTolerance = target;
+    options.batchSize = 1000;
+    options.maxSimulations = 200000;
+
+    MonteCarloEngine adaptive = makeEngine();
+    adaptive.setImportanceSampling(importanceSampling);
+    const AdaptiveResult result = adaptive.runAdaptiveSimulation(method, 10.0, param2, options);
+    const std::vector<double> contributions = adaptive.getRiskContributions();
+    const auto nDrawn = static_cast<size_t>(adaptive.getSimulatedLosses().rows());
+
+    MonteCarloEngine plain = makeEngine();
+    plain.setImportanceSampling(importanceSampling);
+    plain.setNumSimulations(nDrawn);
+    plain.runSimulation(method, 10.0, param2);
+    plain.computeRiskContributions(RiskMeasure::ES);
+    const double diff = maxDifference(contributions, plain.getRiskContributions());
+
+    std::cout << name << " | target " << target << "\t| half-width " << result.relativeHalfWidth
+              << "\t| " << result.nBatches << " batches, " << nDrawn << " paths"
+              << "\t| converged: " << (result.converged ? "yes" : "no")
+              << "\t| max difference to runSimulation: " << diff << std::endl;
+    if (!result.converged || !(result.relativeHalfWidth <= target)) ++failures;
+    if (nDrawn != result.nBatches * options.batchSize) ++failures;
+    if (diff != 0.0) ++failures;
+    return result;
+  };
+
+  // -------------------------------------------------------
+  // Example 1: A loose and a tight target on plain paths
+  // -------------------------------------------------------
+  {
+    const AdaptiveResult loose = runToTarget("Vanilla, loose ", SimulationMethod::Vanilla, 0.0, false, 0.05);
+    const AdaptiveResult tight = runToTarget("Vanilla, tight ", SimulationMethod::Vanilla, 0.0, false, 0.02);
+    if (!(tight.nBatches > loose.nBatches)) ++failures;
+
+    // The half-width is z * SE / ES with the standard error of computeRiskContributions()
+    MonteCarloEngine plain = makeEngine();
+    plain.setNumSimulations(tight.precision.nScenarios);
+    plain.runSimulation(SimulationMethod::Vanilla, 10.0);
+    plain.computeRiskContributions(RiskMeasure::ES);
+    const double halfWidth = 1.959963984540054 * plain.getRiskPrecision().standardError / plain.getPortfolioLoss();
+    std::cout << "Reported half-width " << tight.relativeHalfWidth << " against z SE / ES = " << halfWidth << std::endl;
+    if (std::abs(halfWidth - tight.relativeHalfWidth) > 1e-9 * halfWidth) ++failures;
+  }
+
+  // -------------------------------------------------------
+  // Example 2: Importance-sampled paths, with the sectioning error
+  // -------------------------------------------------------
+  {
+    const AdaptiveResult sampled = runToTarget("Importance     ", SimulationMethod::Stationary, 20.0, true, 0.03);
+    // Sections need at least five batches before their spread may stop the run
+    if (sampled.nBatches < 5) ++failures;
+  }
+
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,114 @@
+//
+// Created by user on 10/15/26.
+//
+
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "quantdream/legacy/monteCarlo/aliasSampler.h"
+#include "quantdream/legacy/monteCarlo/engine.h"
+#include "syntheticData.h"
+
+// Pearson statistic of the draws of sampler against its input scores, over the categories with
+// a positive score; draws of a zero-score category are counted in zeroDraws
+double chiSquare(const AliasSampler &sampler, const std::vector<double> &scores, const size_t nDraws,
+                 size_t &zeroDraws) {
+  std::mt19937 rng(123);
+  std::vector<size_t> counts(scores.size(), 0);
+  for (size_t k = 0; k < nDraws; ++k) ++counts[sampler(rng)];
+
+  double total = 0.0;
+  for (const double s : scores) total += s;
+  double statistic = 0.0;
+  zeroDraws = 0;
+  for (size_t i = 0; i < scores.size(); ++i) {
+    if (scores[i] == 0.0) {
+      zeroDraws += counts[i];
+      continue;
+    }
+    const double expected = static_cast<double>(nDraws) * scores[i] / total;
+    statistic += (static_cast<double>(counts[i]) - expected) * (static_cast<double>(counts[i]) - expected) / expected;
+  }
+  return statistic;
+}
+
+int main() {
+  /** Example of usage of the alias sampler
+   * Draws must follow the normalised scores, never return a zero-score index, and the engine's
+   * cache must hand back the table it already built for the same tilt and weights.
+   */
+
+  // -------------------------------------------------------
+  // Parameters
+  // -------------------------------------------------------
+  const size_t nDraws = 1000000;
+  int failures = 0;
+
+  // -------------------------------------------------------
+  // Example 1: Empirical frequencies, with a zero-score entry
+  // -------------------------------------------------------
+  {
+    const std::vector<double> scores = {1.0, 0.0, 3.0, 6.0, 0.5};
+    const AliasSampler sampler(scores);
+    size_t zeroDraws = 0;
+    const double statistic = chiSquare(sampler, scores, nDraws, zeroDraws);
+
+    // 99.9% quantile of the chi-square with 3 degrees of freedom (4 positive scores)
+    const double critical = 16.27;
+    std::cout << "Scores {1, 0, 3, 6, 0.5} | chi-square = " << statistic << " (critical " << critical << ")"
+              << "\t| draws of the zero score: " << zeroDraws
+              << "\t| probability(2) = " << sampler.probability(2) << std::endl;
+    if (!(statistic < critical) || zeroDraws != 0) ++failures;
+    if (std::abs(sampler.probability(2) - 3.0 / 10.5) > 1e-15 || sampler.probability(1) != 0.0) ++failures;
+  }
+
+  // -------------------------------------------------------
+  // Example 2: A single category, and scores summing to zero
+  // -------------------------------------------------------
+  {
+    const AliasSampler single(std::vector<double>{2.5});
+    std::mt19937 rng(7);
+    bool alwaysZero = true;
+    for (size_t k = 0; k < 1000; ++k) alwaysZero = alwaysZero && single(rng) == 0;
+    std::cout << "Single category | always index 0: " << (alwaysZero ? "yes" : "no")
+              << "\t| probability = " << single.probability(0) << std::endl;
+    if (!alwaysZero || single.probability(0) != 1.0) ++failures;
+
+    // Falls back to the uniform distribution
+    const std::vector<double> zeros(4, 0.0);
+    const AliasSampler uniform(zeros);
+    size_t zeroDraws = 0;
+    const double statistic = chiSquare(uniform, std::vector<double>(4, 1.0), nDraws, zeroDraws);
+    std::cout << "Zero scores | chi-square against uniform = " << statistic << " (critical 16.27)" << std::endl;
+    if (!(statistic < 16.27)) ++failures;
+  }
+
+  // -------------------------------------------------------
+  // Example 3: The engine's cache returns the table it built
+  // -------------------------------------------------------
+  {
+    MonteCarloEngine mc(makeSyntheticData(600, 4), 100, 60, 5, 5);
+    mc.selectCategory("Close");
+    mc.setWeights({0.4, 0.3, 0.2, 0.1});
+
+    const auto first = mc.startSampler(SimulationMethod::Stationary, 10, 50.0);
+    const auto hit = mc.startSampler(SimulationMethod::Stationary, 10, 50.0);
+    const auto otherTilt = mc.startSampler(SimulationMethod::Stationary, 10, 20.0);
+    mc.setWeights({0.25, 0.25, 0.25, 0.25});
+    const auto otherWeights = mc.startSampler(SimulationMethod::Stationary, 10, 50.0);
+    mc.setWeights({0.4, 0.3, 0.2, 0.1});
+    const auto again = mc.startSampler(SimulationMethod::Stationary, 10, 50.0);
+
+    const bool same = hit == first && again == first && hit->probabilities() == first->probabilities();
+    const bool rebuilt = otherTilt != first && otherWeights != first &&
+                         otherWeights->probabilities() != first->probabilities();
+    std::cout << "Cache | hit returns the same table: " << (same ? "yes" : "no")
+              << "\t| new tilt or weights build a new one: " << (rebuilt ? "yes" : "no") << std::endl;
+    if (!same || !rebuilt) ++failures;
+  }
+
+  return failures == 0 ? 0 : 1;
+}
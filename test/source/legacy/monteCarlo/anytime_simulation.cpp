@@ -0,0 +1,130 @@
+//
+// Created by user on 10/15/26.
+//
+
+#include <chrono>
+#include <iostream>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "quantdream/legacy/monteCarlo/engine.h"
+#include "syntheticData.h"
+
+int main() {
+  /** Example of usage of the anytime simulation
+   * Paths are drawn in small batches until the deadline or a stop request. The call must return
+   * shortly after either, and the partial result must be the one of runSimulation() over the
+   * paths it finished, since path i is the same whether the run is cut short or not.
+   */
+  using Clock = std::chrono::steady_clock;
+  using std::chrono::milliseconds;
+
+  // -------------------------------------------------------
+  // Parameters
+  // -------------------------------------------------------
+  const YFData data = makeSyntheticData(600, 4);
+  const size_t nSimulations = 1000000;  // Far more than any cut-short run finishes
+  const size_t nSamples = 60;
+  const size_t blockSize = 5;
+  const size_t alpha = 5;
+  const std::vector<double> weights = {0.4, 0.3, 0.2, 0.1};
+  // Time allowed past the deadline or the stop request: one batch, with ample slack
+  const auto allowance = milliseconds(500);
+
+  int failures = 0;
+
+  auto makeEngine = [&](const size_t n) {
+    MonteCarloEngine mc(data, n, nSamples, blockSize, alpha);
+    mc.selectCategory("Close");
+    mc.setSeed(42);
+    mc.setNumThreads(4);
+    mc.setScenarioStorage(ScenarioStorage::Losses);
+    mc.setWeights(weights);
+    return mc;
+  };
+
+  // The partial ES against runSimulation() over the same number of paths. Both must be the first
+  // run after setSeed(): every later run draws from the next epoch
+  auto checkPartial = [&](const std::string &name, MonteCarloEngine &mc, const AnytimeResult &result,
+                          const Clock::duration overrun) {
+    double diff = 0.0;
+    if (result.nScenarios > 0) {
+      MonteCarloEngine plain = makeEngine(result.nScenarios);
+      plain.runSimulation(SimulationMethod::Vanilla, 10.0);
+      plain.computeRiskContributions(RiskMeasure::ES);
+      diff = maxDifference(mc.getRiskContributions(), plain.getRiskContributions());
+      if (result.precision.nScenarios != result.nScenarios) ++failures;
+    } else if (!mc.getRiskContributions().empty()) {
+      ++failures;
+    }
+    const auto late = std::chrono::duration_cast<milliseconds>(overrun).count();
+    std::cout << name << " | " << result.nScenarios << " paths, completed: " << (result.completed ? "yes" : "no")
+              << "\t| returned " << late << " ms after the cut"
+              << "\t| max difference to runSimulation: " << diff << std::endl;
+    if (overrun > allowance || diff != 0.0) ++failures;
+  };
+
+  // -------------------------------------------------------
+  // Example 1: A deadline already passed, and a tiny one
+  // -------------------------------------------------------
+  {
+    MonteCarloEngine mc = makeEngine(nSimulations);
+    const auto passed = Clock::now() - milliseconds(1);
+    const AnytimeResult none = mc.runAnytimeSimulation(SimulationMethod::Vanilla, 10.0, 0.0, RiskMeasure::ES, passed);
+    checkPartial("Passed deadline", mc, none, Clock::now() - passed);
+    if (none.nScenarios != 0 || none.completed) ++failures;
+
+    MonteCarloEngine cut = makeEngine(nSimulations);
+    const auto deadline = Clock::now() + milliseconds(50);
+    const AnytimeResult partial =
+        cut.runAnytimeSimulation(SimulationMethod::Vanilla, 10.0, 0.0, RiskMeasure::ES, deadline);
+    checkPartial("Tiny deadline  ", cut, partial, Clock::now() - deadline);
+    if (partial.nScenarios == 0 || partial.completed) ++failures;
+  }
+
+  // -------------------------------------------------------
+  // Example 2: Stop requested before the call, and while it runs
+  // -------------------------------------------------------
+  {
+    MonteCarloEngine mc = makeEngine(nSimulations);
+    std::stop_source stopped;
+    stopped.request_stop();
+    const auto before = Clock::now();
+    const AnytimeResult none = mc.runAnytimeSimulation(SimulationMethod::Vanilla, 10.0, 0.0, RiskMeasure::ES,
+                                                       Clock::time_point::max(), stopped.get_token());
+    checkPartial("Stopped before ", mc, none, Clock::now() - before);
+    if (none.nScenarios != 0) ++failures;
+
+    MonteCarloEngine cut = makeEngine(nSimulations);
+    std::stop_source source;
+    Clock::time_point requested;
+    std::thread canceller([&]() {
+      std::this_thread::sleep_for(milliseconds(50));
+      requested = Clock::now();
+      source.request_stop();
+    });
+    const AnytimeResult partial = cut.runAnytimeSimulation(SimulationMethod::Vanilla, 10.0, 0.0, RiskMeasure::ES,
+                                                           Clock::time_point::max(), source.get_token());
+    const auto returned = Clock::now();
+    canceller.join();
+    checkPartial("Stopped during ", cut, partial, returned - requested);
+    if (partial.nScenarios == 0 || partial.completed) ++failures;
+  }
+
+  // -------------------------------------------------------
+  // Example 3: No deadline: every path, as runSimulation() draws them
+  // -------------------------------------------------------
+  {
+    MonteCarloEngine mc = makeEngine(5000);
+    const auto before = Clock::now();
+    const AnytimeResult all = mc.runAnytimeSimulation(SimulationMethod::Vanilla, 10.0, 0.0, RiskMeasure::ES);
+    checkPartial("No deadline    ", mc, all, Clock::duration::zero());
+    std::cout << "  (took " << std::chrono::duration_cast<milliseconds>(Clock::now() - before).count() << " ms)"
+              << std::endl;
+    if (all.nScenarios != 5000 || !all.completed) ++failures;
+  }
+
+  return failures == 0 ? 0 : 1;
+}
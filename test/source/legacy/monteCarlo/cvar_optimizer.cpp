@@ -0,0 +1,94 @@
+//
+// Created by user on 10/15/26.
+//
+
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "quantdream/legacy/monteCarlo/CVaROptimizer.h"
+#include "syntheticData.h"
+
+// Report one solution against the expected weights and ES, and count it as failed when they differ
+void check(const std::string &name, const CVaRSolution &solution, const std::vector<double> &weights,
+           const double ES, int &failures) {
+  const double diff = std::max(maxDifference(solution.weights, weights), std::abs(solution.ES - ES));
+  const bool ok = solution.optimal && diff <= 1e-9;
+  std::cout << name << "\t| ES = " << solution.ES << " (expected " << ES << ")"
+            << "\t| max difference: " << diff << "\t| " << (ok ? "ok" : "FAILED") << std::endl;
+  if (!ok) ++failures;
+}
+
+// Count a call as failed unless it throws std::runtime_error
+template<typename F>
+void expectThrow(const std::string &name, F &&f, int &failures) {
+  bool thrown = false;
+  try {
+    f();
+  } catch (const std::runtime_error &) {
+    thrown = true;
+  }
+  std::cout << name << "\t| " << (thrown ? "rejected" : "FAILED: accepted") << std::endl;
+  if (!thrown) ++failures;
+}
+
+int main() {
+  /** Example of usage of the CVaR linear program
+   * Four equally likely scenarios at alpha = 25%: the ES is the loss of the worst scenario, so
+   * every optimum can be checked by hand. Assets A and B lose 3 in one scenario each, asset C
+   * loses 1 in every scenario. With weights (a, b, c) the ES is max(1 + 2a - b, 1 + 2b - a, c).
+   */
+
+  // -------------------------------------------------------
+  // Parameters
+  // -------------------------------------------------------
+  Eigen::MatrixXd losses(4, 3);
+  losses << 3.0, 0.0, 1.0,
+            0.0, 3.0, 1.0,
+            0.0, 0.0, 1.0,
+            0.0, 0.0, 1.0;
+  const size_t alpha = 25;
+
+  int failures = 0;
+  CVaROptimizer optimizer(losses, alpha);
+
+  // -------------------------------------------------------
+  // Example 1: Long-only, fully invested
+  // -------------------------------------------------------
+  // max(1 + 2a - b, 1 + 2b - a) >= 1 + (a + b) / 2: all in C, ES = 1
+  check("Long-only          ", optimizer.solve(), {0.0, 0.0, 1.0}, 1.0, failures);
+
+  // -------------------------------------------------------
+  // Example 2: A binding upper bound on C
+  // -------------------------------------------------------
+  // a + b >= 0.6 and the ES is 1 + (a + b) / 2 at best: a = b = 0.3, ES = 1.3
+  optimizer.setBounds({0.0, 0.0, 0.0}, {1.0, 1.0, 0.4});
+  check("C <= 0.4           ", optimizer.solve(), {0.3, 0.3, 0.4}, 1.3, failures);
+
+  // -------------------------------------------------------
+  // Example 3: A binding budget cap on A
+  // -------------------------------------------------------
+  // ES(L_A) = 3, so 3a <= ES / 2. With a + b = 0.6 the ES is 2.2 - 3a and the cap gives
+  // a <= 11/45: w = (11/45, 16/45, 0.4), ES = 22/15
+  const double nan = std::nan("");
+  optimizer.setBudgetCaps({0.5, nan, nan});
+  const CVaRSolution capped = optimizer.solve();
+  check("C <= 0.4, A cap 50%", capped, {11.0 / 45.0, 16.0 / 45.0, 0.4}, 22.0 / 15.0, failures);
+  const double share = 3.0 * capped.weights[0] / capped.ES;
+  std::cout << "Stand-alone share of A: " << share << " (cap 0.5)" << std::endl;
+  if (!(std::abs(share - 0.5) <= 1e-9)) ++failures;
+
+  // -------------------------------------------------------
+  // Example 4: Bounds without a feasible portfolio are rejected
+  // -------------------------------------------------------
+  expectThrow("Lower above upper  ", [&]() { optimizer.setBounds({0.5, 0.0, 0.0}, {0.4, 1.0, 1.0}); }, failures);
+  expectThrow("Lower sum above one", [&]() { optimizer.setBounds({0.5, 0.5, 0.5}, {1.0, 1.0, 1.0}); }, failures);
+  expectThrow("Upper sum below one", [&]() { optimizer.setBounds({0.0, 0.0, 0.0}, {0.3, 0.3, 0.3}); }, failures);
+  expectThrow("Group lower > upper", [&]() { optimizer.addGroup({0, 1}, 0.5, 0.4); }, failures);
+  // C <= 0.4 is still in place: A and B together hold at least 0.6
+  expectThrow("Group out of reach ", [&]() { optimizer.addGroup({2}, 0.5, 1.0); }, failures);
+
+  return failures == 0 ? 0 : 1;
+}
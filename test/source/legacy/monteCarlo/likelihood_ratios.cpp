@@ -0,0 +1,171 @@
+//
+// Created by user on 10/15/26.
+//
+
+#include <cmath>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "quantdream/legacy/monteCarlo/engine.h"
+#include "syntheticData.h"
+
+// Kish effective sample size of a set of weights: (sum r)^2 / sum r^2
+double effectiveSize(const std::vector<double> &ratios) {
+  const double sum = std::accumulate(ratios.begin(), ratios.end(), 0.0);
+  const double squares = std::inner_product(ratios.begin(), ratios.end(), ratios.begin(), 0.0);
+  return sum * sum / squares;
+}
+
+int main() {
+  /** Example of usage of likelihood-ratio weighted scenario sets
+   * One scenario set simulated at some weights can be re-evaluated at other weights: Vanilla
+   * scenarios do not depend on the weights, tilted ones are reweighted by the ratio of the
+   * block-start distributions, and must agree with a fresh simulation within its noise.
+   */
+
+  // -------------------------------------------------------
+  // Parameters
+  // -------------------------------------------------------
+  const YFData data = makeSyntheticData(600, 4);
+  const size_t nSimulations = 20000;
+  const size_t nSamples = 60;
+  const size_t blockSize = 5;
+  const size_t alpha = 5;
+  const std::vector<double> drawnWeights = {0.25, 0.25, 0.25, 0.25};
+  const std::vector<double> newWeights = {0.4, 0.3, 0.2, 0.1};
+
+  int failures = 0;
+
+  auto makeEngine = [&](const size_t seed) {
+    MonteCarloEngine mc(data, nSimulations, nSamples, blockSize, alpha);
+    mc.selectCategory("Close");
+    mc.setSeed(seed);
+    mc.setNumThreads(4);
+    mc.setScenarioStorage(ScenarioStorage::Losses);
+    return mc;
+  };
+
+  // -------------------------------------------------------
+  // Example 1: Vanilla scenarios re-evaluated at new weights
+  // -------------------------------------------------------
+  {
+    MonteCarloEngine mc = makeEngine(42);
+    mc.setWeights(drawnWeights);
+    mc.runSimulation(SimulationMethod::Vanilla, 10.0);
+
+    mc.setWeights(newWeights);
+    mc.reevaluateRiskContributions(RiskMeasure::ES);
+    const std::vector<double> reevaluated = mc.getRiskContributions();
+    mc.computeRiskContributions(RiskMeasure::ES);
+    const double diff = maxDifference(reevaluated, mc.getRiskContributions());
+
+    std::cout << "Vanilla    | re-evaluated ES = " << reevaluated.back()
+              << "\t| max difference to computeRiskContributions: " << diff << std::endl;
+    if (diff != 0.0) ++failures;
+  }
+
+  // -------------------------------------------------------
+  // Example 2: Tilted scenarios reweighted against a fresh simulation
+  // -------------------------------------------------------
+  const SimulationMethod methods[] = {SimulationMethod::LambdaBias, SimulationMethod::Stationary};
+  for (const SimulationMethod method : methods) {
+    // Squared daily losses are ~1e-4: lambda close to one is needed for a visible tilt
+    const double param1 = method == SimulationMethod::LambdaBias ? 0.9999 : 10.0;
+    const double param2 = method == SimulationMethod::LambdaBias ? 0.0 : 30.0;
+
+    // Drawn at equal weights, reweighted to the new ones
+    MonteCarloEngine reused = makeEngine(42);
+    reused.setWeights(drawnWeights);
+    reused.runSimulation(method, param1, param2);
+    reused.setWeights(newWeights);
+    reused.reevaluateRiskContributions(RiskMeasure::ES);
+    const double reweighted = reused.getPortfolioLoss();
+    const double reusedSize = effectiveSize(reused.reweightingRatios());
+
+    // Drawn at the new weights with another seed
+    MonteCarloEngine fresh = makeEngine(7);
+    fresh.setWeights(newWeights);
+    fresh.runSimulation(method, param1, param2);
+    fresh.computeRiskContributions(RiskMeasure::ES);
+    const double freshES = fresh.getPortfolioLoss();
+    const double freshError = fresh.getRiskPrecision().standardError;
+
+    // The reweighted estimate has the error of its effective sample size
+    const double reusedError = freshError * std::sqrt(static_cast<double>(nSimulations) / reusedSize);
+    const double z = std::abs(reweighted - freshES) / std::hypot(freshError, reusedError);
+
+    std::cout << (method == SimulationMethod::LambdaBias ? "LambdaBias" : "Stationary")
+              << " | reweighted ES = " << reweighted << " (ESS " << reusedSize << ")"
+              << "\t| fresh ES = " << freshES << " +- " << freshError
+              << "\t| z = " << z << std::endl;
+    if (!(z < 3.0)) ++failures;
+  }
+
+  // -------------------------------------------------------
+  // Example 3: Importance sampling with unit ratios is the plain estimator
+  // -------------------------------------------------------
+  {
+    MonteCarloEngine mc = makeEngine(42);
+    mc.setWeights(newWeights);
+    mc.runSimulation(SimulationMethod::Vanilla, 10.0);
+
+    // alpha% of nSimulations is a whole number, so the tails coincide
+    const std::vector<double> ones(nSimulations, 1.0);
+    double diff = 0.0;
+    for (const RiskMeasure measure : {RiskMeasure::VaR, RiskMeasure::ES}) {
+      diff = std::max(diff, maxDifference(
+          computeImportanceSampledRiskMeasures(mc.getSimulatedLosses(), newWeights, ones, alpha, measure),
+          computePortfolioRiskMeasures(mc.getSimulatedLosses(), newWeights, alpha, measure)));
+    }
+    std::cout << "Unit ratios | max difference to the plain estimator: " << diff << std::endl;
+    if (diff > 1e-12) ++failures;
+  }
+
+  // -------------------------------------------------------
+  // Example 4: Tilted, importance-sampled runs estimate the untilted ES
+  // -------------------------------------------------------
+  {
+    const size_t nSeeds = 10;
+    const double theta = 50.0;
+    std::vector<double> plain;
+    std::vector<double> sampled;
+    double meanRatio = 0.0;
+    for (size_t seed = 0; seed < nSeeds; ++seed) {
+      MonteCarloEngine mc = makeEngine(100 + seed);
+      mc.setWeights(newWeights);
+      mc.setNumSimulations(5000);
+      mc.runSimulation(SimulationMethod::Stationary, 10.0, 0.0);
+      mc.computeRiskContributions(RiskMeasure::ES);
+      plain.push_back(mc.getPortfolioLoss());
+
+      mc.setImportanceSampling(true);
+      mc.runSimulation(SimulationMethod::Stationary, 10.0, theta);
+      mc.computeRiskContributions(RiskMeasure::ES);
+      sampled.push_back(mc.getPortfolioLoss());
+      const std::vector<double> &ratios = mc.getLikelihoodRatios();
+      meanRatio += std::accumulate(ratios.begin(), ratios.end(), 0.0) / static_cast<double>(ratios.size() * nSeeds);
+    }
+
+    // Mean and standard error of the mean over the seeds
+    auto summary = [&](const std::vector<double> &values) {
+      const double mean = std::accumulate(values.begin(), values.end(), 0.0) / static_cast<double>(nSeeds);
+      double variance = 0.0;
+      for (const double v : values) variance += (v - mean) * (v - mean) / static_cast<double>(nSeeds - 1);
+      return std::make_pair(mean, std::sqrt(variance / static_cast<double>(nSeeds)));
+    };
+    const auto [plainES, plainError] = summary(plain);
+    const auto [sampledES, sampledError] = summary(sampled);
+    const double z = std::abs(sampledES - plainES) / std::hypot(plainError, sampledError);
+
+    std::cout << "Untilted ES = " << plainES << " +- " << plainError
+              << "	| tilted (theta " << theta << ") with ratios = " << sampledES << " +- " << sampledError
+              << "	| z = " << z << "	| mean ratio = " << meanRatio << std::endl;
+    if (!(z < 3.0)) ++failures;
+    if (!(std::abs(meanRatio - 1.0) < 0.05)) ++failures;
+  }
+
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,111 @@
+//
+// Created by user on 10/15/26.
+//
+
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "quantdream/legacy/monteCarlo/rollingBacktest.h"
+
+// Three normal assets and a quiet one that crashes now and then: its ES share is far from its
+// volatility share, so covariance risk parity is a poor start for the ES budgets
+YFData makeCrashData(const size_t nDates) {
+  YFData data;
+  std::mt19937 rng(7);
+  std::normal_distribution<double> shock(0.0, 1.0);
+  std::bernoulli_distribution crash(0.03);
+  const std::vector<double> volatilities = {0.010, 0.010, 0.010, 0.004};
+
+  std::vector<double> prices(volatilities.size(), 100.0);
+  for (size_t t = 0; t < nDates; ++t) {
+    char date[32];
+    std::snprintf(date, sizeof(date), "2000-%06zu", t);
+    for (size_t j = 0; j < prices.size(); ++j) {
+      double r = 0.0003 + volatilities[j] * shock(rng);
+      if (j + 1 == prices.size() && crash(rng)) r -= 0.06;
+      prices[j] *= 1.0 + r;
+      data[date]["Close"]["T" + std::to_string(j)] = prices[j];
+    }
+  }
+  return data;
+}
+
+int main() {
+  /** Example of usage of the rolling backtest
+   * Every date has its own seed, so the weights must not depend on the thread count. A date
+   * started from the previous date's weights must need fewer solver iterations than the same
+   * date started cold from covariance risk parity.
+   */
+
+  // -------------------------------------------------------
+  // Parameters
+  // -------------------------------------------------------
+  const YFData data = makeCrashData(600);
+  RollingBacktestOptions options;
+  options.nSimulations = 2000;
+  options.nSamples = 20;
+  options.tol = 1e-2;
+  options.commonRandomNumbers = true;  // Iterations then measure the distance to the solution, not noise
+
+  // Every 20th date once minHistory returns are available
+  std::vector<std::string> dates;
+  size_t index = 0;
+  for (const auto &[date, prices] : data) {
+    if (index > options.minHistory && (index - options.minHistory) % 20 == 0) dates.push_back(date);
+    ++index;
+  }
+
+  int failures = 0;
+
+  auto run = [&](const size_t nChains, const size_t nThreads) {
+    RollingBacktestOptions o = options;
+    o.nChains = nChains;
+    o.nThreads = nThreads;
+    return RollingBacktest(data, o).run(dates);
+  };
+
+  // -------------------------------------------------------
+  // Example 1: Identical weights on one and on four threads
+  // -------------------------------------------------------
+  for (const size_t nChains : {size_t{1}, size_t{3}}) {
+    const std::vector<RollingRebalance> serial = run(nChains, 1);
+    const std::vector<RollingRebalance> parallel = run(nChains, 4);
+    bool same = serial.size() == parallel.size() && serial.size() == dates.size();
+    for (size_t k = 0; same && k < serial.size(); ++k) {
+      same = serial[k].date == parallel[k].date && serial[k].weights == parallel[k].weights &&
+             serial[k].iterations == parallel[k].iterations;
+    }
+    std::cout << nChains << " chain(s) | " << serial.size() << " dates"
+              << "\t| 1 and 4 threads give the same weights: " << (same ? "yes" : "no") << std::endl;
+    if (!same) ++failures;
+  }
+
+  // -------------------------------------------------------
+  // Example 2: Warm starts need fewer iterations than cold ones
+  // -------------------------------------------------------
+  {
+    const std::vector<RollingRebalance> warm = run(1, 4);
+    // One chain per date: every date starts cold
+    const std::vector<RollingRebalance> cold = run(dates.size(), 4);
+
+    // Over the dates both solves converge on (the fixed point may cycle between tails)
+    size_t warmIterations = 0;
+    size_t coldIterations = 0;
+    size_t nCompared = 0;
+    for (size_t k = 0; k < warm.size() && k < cold.size(); ++k) {
+      if (!warm[k].warmStarted || cold[k].warmStarted) continue;
+      if (warm[k].iterations >= options.maxIterations || cold[k].iterations >= options.maxIterations) continue;
+      warmIterations += warm[k].iterations;
+      coldIterations += cold[k].iterations;
+      ++nCompared;
+    }
+    std::cout << "Warm start | " << warmIterations << " iterations over " << nCompared << " dates"
+              << "\t| cold start: " << coldIterations << std::endl;
+    if (nCompared < dates.size() / 2 || !(warmIterations < coldIterations)) ++failures;
+  }
+
+  return failures == 0 ? 0 : 1;
+}
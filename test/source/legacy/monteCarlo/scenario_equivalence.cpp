@@ -0,0 +1,282 @@
+//
+// Created by user on 10/15/26.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <iterator>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "quantdream/legacy/monteCarlo/ERCOptimizer.h"
+#include "syntheticData.h"
+
+// Largest |rc_i - ES / n| over the ES, from the contributions followed by the ES
+double relativeDispersion(const std::vector<double> &contributions) {
+  const double ES = contributions.back();
+  const double target = ES / static_cast<double>(contributions.size() - 1);
+  double dispersion = 0.0;
+  for (size_t i = 0; i + 1 < contributions.size(); ++i) {
+    dispersion = std::max(dispersion, std::abs(contributions[i] - target));
+  }
+  return dispersion / ES;
+}
+
+// Report one check and count it as failed when diff exceeds tolerance
+bool check(const std::string &name, const double diff, const double tolerance, int &failures) {
+  const bool ok = diff <= tolerance;
+  std::cout << name << "\t| max difference: " << diff << "\t| " << (ok ? "ok" : "FAILED") << std::endl;
+  if (!ok) ++failures;
+  return ok;
+}
+
+int main() {
+  /** Equivalences the engine promises between its code paths
+   * Each example runs two paths that must agree on the same scenarios, exactly or up to
+   * floating point rounding, so that later refactors cannot break them silently.
+   */
+
+  // -------------------------------------------------------
+  // Parameters
+  // -------------------------------------------------------
+  const YFData data = makeSyntheticData(600, 4);
+  const size_t nSimulations = 1000;
+  const size_t nSamples = 60;
+  const size_t blockSize = 5;
+  const size_t alpha = 5;
+  const std::vector<double> weights = {0.4, 0.3, 0.2, 0.1};
+
+  int failures = 0;
+
+  auto makeEngine = [&]() {
+    MonteCarloEngine mc(data, nSimulations, nSamples, blockSize, alpha);
+    mc.selectCategory("Close");
+    mc.setSeed(42);
+    mc.setNumThreads(4);
+    mc.setWeights(weights);
+    return mc;
+  };
+
+  // -------------------------------------------------------
+  // Example 1: Losses and Compact storage against Full storage
+  // -------------------------------------------------------
+  {
+    std::vector<Eigen::MatrixXd> losses;
+    std::vector<std::vector<double>> contributions;
+    for (const ScenarioStorage storage : {ScenarioStorage::Full, ScenarioStorage::Losses, ScenarioStorage::Compact}) {
+      MonteCarloEngine mc = makeEngine();
+      mc.setScenarioStorage(storage);
+      mc.runSimulation(SimulationMethod::Stationary, 10.0, 20.0);
+      losses.push_back(mc.getSimulatedLosses());
+      mc.computeRiskContributions(RiskMeasure::ES);
+      contributions.push_back(mc.getRiskContributions());
+    }
+
+    check("Losses storage, losses  ", (losses[1] - losses[0]).cwiseAbs().maxCoeff(), 0.0, failures);
+    check("Compact storage, losses ", (losses[2] - losses[0]).cwiseAbs().maxCoeff(), 0.0, failures);
+    check("Losses storage, ES      ", maxDifference(contributions[1], contributions[0]), 0.0, failures);
+    check("Compact storage, ES     ", maxDifference(contributions[2], contributions[0]), 0.0, failures);
+  }
+
+  // -------------------------------------------------------
+  // Example 2: Prefix-sum path losses against the running product
+  // -------------------------------------------------------
+  {
+    std::vector<Eigen::MatrixXd> losses;
+    std::vector<std::vector<double>> contributions;
+    for (const LossAccumulation accumulation : {LossAccumulation::Product, LossAccumulation::PrefixSum}) {
+      MonteCarloEngine mc = makeEngine();
+      mc.setScenarioStorage(ScenarioStorage::Losses);
+      mc.setLossAccumulation(accumulation);
+      mc.runSimulation(SimulationMethod::Vanilla, 10.0);
+      losses.push_back(mc.getSimulatedLosses());
+      mc.computeRiskContributions(RiskMeasure::ES);
+      contributions.push_back(mc.getRiskContributions());
+    }
+
+    // exp of a sum of logs instead of a product: equal up to rounding
+    check("PrefixSum, losses       ", (losses[1] - losses[0]).cwiseAbs().maxCoeff(), 1e-12, failures);
+    check("PrefixSum, ES           ", maxDifference(contributions[1], contributions[0]), 1e-12, failures);
+  }
+
+  // -------------------------------------------------------
+  // Example 3: Many portfolios in one GEMM against one portfolio at a time
+  // -------------------------------------------------------
+  {
+    MonteCarloEngine mc = makeEngine();
+    mc.setScenarioStorage(ScenarioStorage::Losses);
+    mc.runSimulation(SimulationMethod::Vanilla, 10.0);
+
+    Eigen::MatrixXd candidates(4, 3);
+    candidates << 0.25, 0.7, 0.1,
+                  0.25, 0.1, 0.1,
+                  0.25, 0.1, 0.1,
+                  0.25, 0.1, 0.7;
+    for (const RiskMeasure measure : {RiskMeasure::VaR, RiskMeasure::ES}) {
+      const Eigen::MatrixXd batch = mc.computeRiskContributionsBatch(measure, candidates);
+      double diff = 0.0;
+      for (Eigen::Index k = 0; k < candidates.cols(); ++k) {
+        const Eigen::VectorXd column = candidates.col(k);
+        mc.setWeights(std::vector<double>(column.data(), column.data() + column.size()));
+        mc.computeRiskContributions(measure);
+        const Eigen::RowVectorXd row = batch.row(k);
+        diff = std::max(diff, maxDifference(std::vector<double>(row.data(), row.data() + row.size()),
+                                            mc.getRiskContributions()));
+      }
+      check(measure == RiskMeasure::VaR ? "Batch, VaR              " : "Batch, ES               ", diff, 1e-12,
+            failures);
+    }
+  }
+
+  // -------------------------------------------------------
+  // Example 4: Risk surface rows against single-level calls
+  // -------------------------------------------------------
+  {
+    MonteCarloEngine mc = makeEngine();
+    mc.setScenarioStorage(ScenarioStorage::Losses);
+    mc.runSimulation(SimulationMethod::Stationary, 10.0, 20.0);
+
+    const std::vector<double> levels = {0.90, 0.95, 0.99};
+    const std::vector<size_t> alphas = {10, 5, 1};
+    const RiskSurface surface = mc.computeRiskSurface(levels);
+    double diff = 0.0;
+    for (size_t l = 0; l < levels.size(); ++l) {
+      const auto row = static_cast<Eigen::Index>(l);
+      for (const RiskMeasure measure : {RiskMeasure::VaR, RiskMeasure::ES}) {
+        const Eigen::RowVectorXd cells = measure == RiskMeasure::VaR ? surface.VaR.row(row) : surface.ES.row(row);
+        diff = std::max(diff, maxDifference(std::vector<double>(cells.data(), cells.data() + cells.size()),
+                                            computePortfolioRiskMeasures(mc.getSimulatedLosses(), weights,
+                                                                         alphas[l], measure)));
+      }
+    }
+    check("Surface, VaR and ES     ", diff, 1e-12, failures);
+  }
+
+  // -------------------------------------------------------
+  // Example 5: Newton and coordinate descent meet the tolerance on their scenarios
+  // -------------------------------------------------------
+  // The sample ES is piecewise linear, so the contributions can only be equalised up to the
+  // granularity of the tail: 5000 paths leave a tail of 250, enough for tol = 1e-3
+  for (const ERCSolver solver : {ERCSolver::Newton, ERCSolver::CoordinateDescent}) {
+    const double tol = 1e-3;
+    MonteCarloEngine mc = makeEngine();
+    mc.setScenarioStorage(ScenarioStorage::Losses);
+    mc.setNumSimulations(5000);
+
+    ERCOptimizer optimizer(mc, weights.size(), 200, SimulationMethod::Vanilla, 10.0, 0.0);
+    optimizer.setSolver(solver);
+    optimizer.optimize(tol, 1e-10, 0.5, false);
+    // The engine holds the contributions of the solution on the scenarios it was solved on
+    check(solver == ERCSolver::Newton ? "Newton, maxDev/ES       " : "Coordinate, maxDev/ES   ",
+          relativeDispersion(mc.getRiskContributions()), tol, failures);
+  }
+
+  // -------------------------------------------------------
+  // Example 6: Covariance risk parity equalises the volatility contributions
+  // -------------------------------------------------------
+  {
+    // Sample covariance of the daily returns, tickers in the engine's (sorted) order
+    Eigen::MatrixXd returns(static_cast<Eigen::Index>(data.size() - 1),
+                            static_cast<Eigen::Index>(weights.size()));
+    Eigen::Index t = 0;
+    for (auto it = std::next(data.begin()); it != data.end(); ++it, ++t) {
+      Eigen::Index j = 0;
+      for (const auto &[ticker, price] : it->second.at("Close")) {
+        returns(t, j++) = price / std::prev(it)->second.at("Close").at(ticker) - 1.0;
+      }
+    }
+    const Eigen::MatrixXd centred = returns.rowwise() - returns.colwise().mean();
+    const Eigen::MatrixXd covariance = centred.transpose() * centred / static_cast<double>(returns.rows() - 1);
+
+    MonteCarloEngine mc = makeEngine();
+    for (const std::vector<double> &budgets : {std::vector<double>{}, weights}) {
+      const std::vector<double> solution = mc.solveCovarianceRiskParity(1e-12, 100, budgets);
+      const Eigen::VectorXd w =
+          Eigen::Map<const Eigen::VectorXd>(solution.data(), static_cast<Eigen::Index>(solution.size()));
+      // Share of the variance of each asset, w_i (S w)_i / w' S w, against its budget
+      const Eigen::VectorXd shares = w.cwiseProduct(covariance * w) / w.dot(covariance * w);
+      double diff = 0.0;
+      for (Eigen::Index i = 0; i < shares.size(); ++i) {
+        const double budget =
+            budgets.empty() ? 1.0 / static_cast<double>(shares.size()) : budgets[static_cast<size_t>(i)];
+        diff = std::max(diff, std::abs(shares(i) - budget));
+      }
+      check(budgets.empty() ? "Covariance RP, equal    " : "Covariance RP, budgets  ", diff, 1e-10, failures);
+    }
+  }
+
+  // -------------------------------------------------------
+  // Example 7: Risk measures against the original full-path formula
+  // -------------------------------------------------------
+  {
+    MonteCarloEngine mc = makeEngine();
+    mc.runSimulation(SimulationMethod::Stationary, 10.0, 20.0);
+
+    // loss_j = 1 - colwise prod(1 + r), portfolio loss by dot product, sorted tail
+    const size_t nAssets = weights.size();
+    const auto n = static_cast<Eigen::Index>(nAssets);
+    const Eigen::VectorXd eigenWeights = Eigen::Map<const Eigen::VectorXd>(weights.data(), n);
+    Eigen::MatrixXd baseline(static_cast<Eigen::Index>(nSimulations), n + 1);
+    for (size_t i = 0; i < nSimulations; ++i) {
+      const Eigen::VectorXd losses = (1 - (mc.getSimulatedReturns()[i].array() + 1).colwise().prod()).transpose();
+      baseline.row(static_cast<Eigen::Index>(i)).head(n) = losses.transpose();
+      baseline(static_cast<Eigen::Index>(i), n) = losses.dot(eigenWeights);
+    }
+    std::vector<Eigen::Index> order(nSimulations);
+    std::iota(order.begin(), order.end(), Eigen::Index{0});
+    std::sort(order.begin(), order.end(), [&](Eigen::Index a, Eigen::Index b) { return baseline(a, n) < baseline(b, n); });
+    const auto quantileIndex = static_cast<size_t>(std::floor((1 - alpha / 100.0) * nSimulations));
+
+    for (const RiskMeasure measure : {RiskMeasure::VaR, RiskMeasure::ES}) {
+      std::vector<double> expected(nAssets + 1, 0.0);
+      const size_t last = measure == RiskMeasure::VaR ? quantileIndex + 1 : nSimulations;
+      for (size_t k = quantileIndex; k < last; ++k) {
+        for (size_t j = 0; j <= nAssets; ++j) expected[j] += baseline(order[k], static_cast<Eigen::Index>(j));
+      }
+      for (size_t j = 0; j <= nAssets; ++j) {
+        expected[j] /= static_cast<double>(last - quantileIndex);
+        if (j < nAssets) expected[j] *= weights[j];
+      }
+      mc.computeRiskContributions(measure);
+      // Products and sums run in another order than the original: equal up to a few ulps
+      check(measure == RiskMeasure::VaR ? "Original formula, VaR   " : "Original formula, ES    ",
+            maxDifference(mc.getRiskContributions(), expected), 1e-14, failures);
+    }
+  }
+
+  // -------------------------------------------------------
+  // Example 8: Importance-sampled risk surface against single-level calls
+  // -------------------------------------------------------
+  {
+    MonteCarloEngine mc = makeEngine();
+    mc.setScenarioStorage(ScenarioStorage::Losses);
+    mc.setImportanceSampling(true);
+    mc.runSimulation(SimulationMethod::Stationary, 10.0, 20.0);
+
+    const std::vector<double> levels = {0.90, 0.95, 0.99};
+    const std::vector<size_t> alphas = {10, 5, 1};
+    const RiskSurface surface = mc.computeRiskSurface(levels);
+    double diff = 0.0;
+    for (size_t l = 0; l < levels.size(); ++l) {
+      const auto row = static_cast<Eigen::Index>(l);
+      for (const RiskMeasure measure : {RiskMeasure::VaR, RiskMeasure::ES}) {
+        const Eigen::RowVectorXd cells = measure == RiskMeasure::VaR ? surface.VaR.row(row) : surface.ES.row(row);
+        const std::vector<double> surfaceCells(cells.data(), cells.data() + cells.size());
+        diff = std::max(diff, maxDifference(surfaceCells,
+                                            computeImportanceSampledRiskMeasures(mc.getSimulatedLosses(), weights,
+                                                                                 mc.getLikelihoodRatios(), alphas[l],
+                                                                                 measure)));
+        // The engine's own level goes through computeRiskContributions
+        if (alphas[l] == alpha) {
+          mc.computeRiskContributions(measure);
+          diff = std::max(diff, maxDifference(surfaceCells, mc.getRiskContributions()));
+        }
+      }
+    }
+    check("Surface, importance     ", diff, 1e-12, failures);
+  }
+
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,162 @@
+//
+// Created by user on 10/15/26.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "quantdream/legacy/monteCarlo/engine.h"
+#include "quantdream/legacy/monteCarlo/scenarioReduction.h"
+#include "syntheticData.h"
+
+int main() {
+  /** Example of usage of the scenario reduction
+   * The reduced set must be a probability distribution, keep the worst scenarios of the reference
+   * portfolio up to twice alpha% of the mass on at most half of its scenarios, and reproduce the
+   * reference VaR and ES closely. A set no larger than the input is returned as is, and invalid
+   * inputs are rejected.
+   */
+
+  // -------------------------------------------------------
+  // Parameters
+  // -------------------------------------------------------
+  const YFData data = makeSyntheticData(600, 4);
+  const size_t nSimulations = 5000;
+  const size_t nSamples = 60;
+  const size_t blockSize = 5;
+  const size_t alpha = 5;
+  const size_t nReduced = 500;
+  const std::vector<double> weights = {0.4, 0.3, 0.2, 0.1};
+  const auto nAssets = static_cast<Eigen::Index>(weights.size());
+  // Relative VaR and ES error allowed when keeping a tenth of the scenarios
+  const double errorTolerance = 0.02;
+
+  int failures = 0;
+
+  MonteCarloEngine mc(data, nSimulations, nSamples, blockSize, alpha);
+  mc.selectCategory("Close");
+  mc.setSeed(42);
+  mc.setNumThreads(4);
+  mc.setScenarioStorage(ScenarioStorage::Losses);
+  mc.setWeights(weights);
+  mc.runSimulation(SimulationMethod::Vanilla, 10.0);
+  const LossMatrix<double> losses = mc.getSimulatedLosses();
+
+  // Weights summing to one, the tail budget, and the errors on the reference portfolio
+  auto checkReduction = [&](const std::string &name, const ScenarioReduction &reduction,
+                            const std::vector<double> &masses) {
+    const double total = std::accumulate(reduction.weights.begin(), reduction.weights.end(), 0.0);
+
+    // The worst reference losses up to twice alpha% of the mass are the tail
+    const Eigen::VectorXd portfolio = losses * Eigen::Map<const Eigen::VectorXd>(weights.data(), nAssets);
+    std::vector<size_t> order(nSimulations);
+    std::iota(order.begin(), order.end(), size_t{0});
+    std::sort(order.begin(), order.end(), [&](const size_t a, const size_t b) {
+      return portfolio(static_cast<Eigen::Index>(a)) > portfolio(static_cast<Eigen::Index>(b)) ||
+             (portfolio(static_cast<Eigen::Index>(a)) == portfolio(static_cast<Eigen::Index>(b)) && a < b);
+    });
+    const double totalMass = masses.empty() ? 1.0 : std::accumulate(masses.begin(), masses.end(), 0.0);
+    const double tailMass = 2.0 * static_cast<double>(alpha) / 100.0;
+    std::vector<char> inTail(nSimulations, 0);
+    double mass = 0.0;
+    for (size_t k = 0; k < nSimulations && mass < tailMass * (1.0 - 1e-12); ++k) {
+      inTail[order[k]] = 1;
+      mass += masses.empty() ? 1.0 / static_cast<double>(nSimulations) : masses[order[k]] / totalMass;
+    }
+
+    size_t nTail = 0;
+    double keptTailMass = 0.0;
+    for (size_t k = 0; k < reduction.scenarios.size(); ++k) {
+      if (!inTail[reduction.scenarios[k]]) continue;
+      ++nTail;
+      keptTailMass += reduction.weights[k];
+    }
+
+    std::cout << name << " | " << reduction.scenarios.size() << " scenarios, weights sum to " << total
+              << "\t| tail: " << nTail << " scenarios with mass " << keptTailMass
+              << "\t| VaR error " << reduction.VaRError << ", ES error " << reduction.ESError << std::endl;
+    if (reduction.scenarios.size() > nReduced || reduction.scenarios.size() != reduction.weights.size()) ++failures;
+    if (std::abs(total - 1.0) > 1e-12) ++failures;
+    if (nTail > nReduced / 2 || std::abs(keptTailMass - mass) > 1e-12 || keptTailMass < tailMass - 1e-12) ++failures;
+    if (!(reduction.VaRError < errorTolerance) || !(reduction.ESError < errorTolerance)) ++failures;
+  };
+
+  // -------------------------------------------------------
+  // Example 1: Equally likely scenarios, on one and on four threads
+  // -------------------------------------------------------
+  {
+    const ScenarioReduction reduction = reduceScenarios(losses, nReduced, weights, alpha);
+    checkReduction("Equal masses  ", reduction, {});
+
+    const ScenarioReduction parallel = reduceScenarios(losses, nReduced, weights, alpha, {}, 4);
+    const bool same = parallel.scenarios == reduction.scenarios && parallel.weights == reduction.weights;
+    std::cout << "Four threads   | same reduction: " << (same ? "yes" : "no") << std::endl;
+    if (!same) ++failures;
+  }
+
+  // -------------------------------------------------------
+  // Example 2: Unequal, unnormalised scenario masses
+  // -------------------------------------------------------
+  {
+    std::vector<double> masses(nSimulations);
+    for (size_t i = 0; i < nSimulations; ++i) masses[i] = 1.0 + static_cast<double>(i % 7);
+    const ScenarioReduction reduction = reduceScenarios(losses, nReduced, weights, alpha, masses);
+    checkReduction("Unequal masses", reduction, masses);
+  }
+
+  // -------------------------------------------------------
+  // Example 3: No reduction needed: every scenario, with its normalised mass
+  // -------------------------------------------------------
+  {
+    const LossMatrix<double> few = losses.topRows(100);
+    const std::vector<double> masses(100, 2.0);
+    const ScenarioReduction reduction = reduceScenarios(few, 100, weights, alpha, masses);
+    bool identity = reduction.scenarios.size() == 100 && reduction.weights.size() == 100;
+    for (size_t i = 0; identity && i < 100; ++i) {
+      identity = reduction.scenarios[i] == i && reduction.weights[i] == 0.01;
+    }
+    const bool exact = reduction.VaRError == 0.0 && reduction.ESError == 0.0 && reduction.assetESError == 0.0;
+    std::cout << "nReduced >= nScenarios | identity: " << (identity ? "yes" : "no")
+              << "\t| zero errors: " << (exact ? "yes" : "no") << std::endl;
+    if (!identity || !exact) ++failures;
+  }
+
+  // -------------------------------------------------------
+  // Example 4: Invalid inputs are rejected
+  // -------------------------------------------------------
+  {
+    const LossMatrix<double> few = losses.topRows(10);
+    const std::vector<std::pair<std::string, std::function<void()>>> cases = {
+        {"no scenarios", [&]() { reduceScenarios(LossMatrix<double>(0, nAssets), 5, weights, alpha); }},
+        {"one scenario kept", [&]() { reduceScenarios(few, 1, weights, alpha); }},
+        {"weights of 3 assets", [&]() { reduceScenarios(few, 5, {0.5, 0.3, 0.2}, alpha); }},
+        {"masses of 9 scenarios", [&]() { reduceScenarios(few, 5, weights, alpha, std::vector<double>(9, 1.0)); }},
+        {"a negative mass",
+         [&]() {
+           std::vector<double> masses(10, 1.0);
+           masses[3] = -0.5;
+           reduceScenarios(few, 5, weights, alpha, masses);
+         }},
+        {"masses summing to zero", [&]() { reduceScenarios(few, 5, weights, alpha, std::vector<double>(10, 0.0)); }},
+    };
+    for (const auto &[name, call] : cases) {
+      bool thrown = false;
+      try {
+        call();
+      } catch (const std::runtime_error &) {
+        thrown = true;
+      }
+      std::cout << "Rejects " << name << ": " << (thrown ? "yes" : "no") << std::endl;
+      if (!thrown) ++failures;
+    }
+  }
+
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,119 @@
+//
+// Created by user on 10/15/26.
+//
+
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "quantdream/legacy/monteCarlo/ERCOptimizer.h"
+#include "syntheticData.h"
+
+int main() {
+  /** Example of usage of the stochastic-approximation ERC solver
+   * Iterates run on small fresh batches that grow to nSimulations as the contribution
+   * dispersion reaches the noise; the solver must stop well before nMaxIterations and land
+   * within the seed-to-seed noise of the fixed-point solution on nSimulations paths.
+   */
+
+  // -------------------------------------------------------
+  // Parameters
+  // -------------------------------------------------------
+  const YFData data = makeSyntheticData(600, 4);
+  const size_t nAssets = 4;
+  const size_t nSimulations = 4000;
+  const size_t nSamples = 60;
+  const size_t blockSize = 5;
+  const size_t alpha = 5;
+  const size_t maxIterations = 200;
+  const size_t nSeeds = 4;
+
+  int failures = 0;
+
+  auto makeEngine = [&](const size_t seed) {
+    MonteCarloEngine mc(data, nSimulations, nSamples, blockSize, alpha);
+    mc.selectCategory("Close");
+    mc.setSeed(seed);
+    mc.setNumThreads(4);
+    mc.setScenarioStorage(ScenarioStorage::Losses);
+    return mc;
+  };
+
+  // -------------------------------------------------------
+  // Example 1: Fixed point on nSimulations paths, over several seeds
+  // -------------------------------------------------------
+  std::vector<double> mean(nAssets, 0.0);
+  std::vector<double> deviation(nAssets, 0.0);
+  std::vector<std::vector<double>> solutions;
+  for (size_t seed = 1; seed <= nSeeds; ++seed) {
+    MonteCarloEngine mc = makeEngine(seed);
+    ERCOptimizer optimizer(mc, nAssets, maxIterations, SimulationMethod::Vanilla, 10.0, 0.0);
+    optimizer.setCommonRandomNumbers(true);
+    solutions.push_back(optimizer.optimize(2e-3, 1e-10, 0.5, false));
+    for (size_t i = 0; i < nAssets; ++i) mean[i] += solutions.back()[i] / static_cast<double>(nSeeds);
+  }
+  for (const auto &w : solutions) {
+    for (size_t i = 0; i < nAssets; ++i) {
+      deviation[i] += (w[i] - mean[i]) * (w[i] - mean[i]) / static_cast<double>(nSeeds - 1);
+    }
+  }
+  for (double &d : deviation) d = std::sqrt(d);
+
+  // -------------------------------------------------------
+  // Example 2: Stochastic approximation stops early, within that noise
+  // -------------------------------------------------------
+  {
+    MonteCarloEngine mc = makeEngine(nSeeds + 1);
+    ERCOptimizer optimizer(mc, nAssets, maxIterations, SimulationMethod::Vanilla, 10.0, 0.0);
+    optimizer.setSolver(ERCSolver::StochasticApproximation);
+
+    // Count the iterations from the verbose log
+    std::ostringstream log;
+    std::streambuf *console = std::cout.rdbuf(log.rdbuf());
+    const std::vector<double> w = optimizer.optimize(1e-4, 1e-10, 0.5, true);
+    std::cout.rdbuf(console);
+    size_t iterations = 0;
+    for (size_t pos = log.str().find("Iter "); pos != std::string::npos; pos = log.str().find("Iter ", pos + 1)) {
+      ++iterations;
+    }
+
+    double worst = 0.0;
+    for (size_t i = 0; i < nAssets; ++i) {
+      // Difference to the fixed-point mean, in standard deviations of one solution against that mean
+      const double scale = deviation[i] * std::sqrt(1.0 + 1.0 / static_cast<double>(nSeeds));
+      worst = std::max(worst, std::abs(w[i] - mean[i]) / scale);
+    }
+
+    std::cout << "Stochastic approximation | iterations " << iterations << " of " << maxIterations
+              << "\t| largest weight difference to the fixed point: " << worst << " sd" << std::endl;
+    if (iterations >= maxIterations) ++failures;
+    if (!(worst < 3.0)) ++failures;
+  }
+
+  // -------------------------------------------------------
+  // Example 3: The engine's simulation count survives a failing solve
+  // -------------------------------------------------------
+  {
+    MonteCarloEngine mc = makeEngine(1);
+    // A reduction to a single scenario is rejected by every runSimulation()
+    mc.setReducedScenarios(1);
+    ERCOptimizer optimizer(mc, nAssets, maxIterations, SimulationMethod::Vanilla, 10.0, 0.0);
+    optimizer.setSolver(ERCSolver::StochasticApproximation);
+
+    bool thrown = false;
+    try {
+      optimizer.optimize(1e-4, 1e-10, 0.5, false);
+    } catch (const std::runtime_error &) {
+      thrown = true;
+    }
+    std::cout << "Failing solve | threw: " << (thrown ? "yes" : "no")
+              << "\t| simulations after: " << mc.getNumSimulations() << " (expected " << nSimulations << ")"
+              << std::endl;
+    if (!thrown || mc.getNumSimulations() != nSimulations) ++failures;
+  }
+
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,46 @@
+//
+// Created by user on 10/15/26.
+//
+
+#ifndef QUANTDREAMCPP_TEST_SYNTHETICDATA_H
+#define QUANTDREAMCPP_TEST_SYNTHETICDATA_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "quantdream/legacy/monteCarlo/engine.h"
+
+// Build a small synthetic price panel in the YFinance layout: independent normal daily returns
+inline YFData makeSyntheticData(const size_t nDates,
+                                const size_t nAssets,
+                                const unsigned seed = 7,
+                                const double mean = 0.0003,
+                                const double volatility = 0.012) {
+  YFData data;
+  std::mt19937 rng(seed);
+  std::normal_distribution<double> shock(mean, volatility);
+
+  std::vector<double> prices(nAssets, 100.0);
+  for (size_t t = 0; t < nDates; ++t) {
+    char date[32];
+    std::snprintf(date, sizeof(date), "2000-%06zu", t);
+    for (size_t j = 0; j < nAssets; ++j) {
+      prices[j] *= 1.0 + shock(rng);
+      data[date]["Close"]["T" + std::to_string(j)] = prices[j];
+    }
+  }
+  return data;
+}
+
+// Largest absolute difference between two vectors of the same size
+inline double maxDifference(const std::vector<double> &a, const std::vector<double> &b) {
+  double diff = 0.0;
+  for (size_t j = 0; j < a.size(); ++j) diff = std::max(diff, std::abs(a[j] - b[j]));
+  return diff;
+}
+
+#endif  // QUANTDREAMCPP_TEST_SYNTHETICDATA_H
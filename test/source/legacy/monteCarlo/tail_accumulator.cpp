@@ -0,0 +1,87 @@
+//
+// Created by user on 10/15/26.
+//
+
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "quantdream/legacy/monteCarlo/engine.h"
+#include "quantdream/legacy/monteCarlo/tailAccumulator.h"
+#include "syntheticData.h"
+
+int main() {
+  /** Example of usage of the streaming tail accumulator
+   * ScenarioStorage::Tail keeps only the worst alpha% of the paths, reduced inside the
+   * generator threads, and must give the same VaR / ES as keeping every path's losses.
+   */
+
+  // -------------------------------------------------------
+  // Parameters
+  // -------------------------------------------------------
+  const YFData data = makeSyntheticData(500, 5, 11, 0.0002, 0.015);
+  const size_t nSimulations = 2000;
+  const size_t nSamples = 60;
+  const size_t blockSize = 5;
+  const size_t alpha = 5;
+  const double tolerance = 1e-12;
+
+  int failures = 0;
+
+  // -------------------------------------------------------
+  // Example 1: Tail storage against full loss storage
+  // -------------------------------------------------------
+  for (const RiskMeasure measure : {RiskMeasure::VaR, RiskMeasure::ES}) {
+    std::vector<std::vector<double>> results;
+    for (const ScenarioStorage storage : {ScenarioStorage::Losses, ScenarioStorage::Tail}) {
+      MonteCarloEngine mc(data, nSimulations, nSamples, blockSize, alpha);
+      mc.selectCategory("Close");
+      mc.setSeed(42);
+      mc.setNumThreads(4);
+      mc.setScenarioStorage(storage);
+      mc.runSimulation(SimulationMethod::Stationary, 10.0, 20.0);
+      mc.computeRiskContributions(measure);
+      results.push_back(mc.getRiskContributions());
+    }
+
+    const double diff = maxDifference(results[0], results[1]);
+    std::cout << (measure == RiskMeasure::VaR ? "VaR" : "ES ") << " = " << results[0].back()
+              << "\t| tail storage max difference: " << diff << std::endl;
+    if (diff > tolerance) ++failures;
+  }
+
+  // -------------------------------------------------------
+  // Example 2: Merging partial accumulators in any order
+  // -------------------------------------------------------
+  const size_t nAssets = 4;
+  const std::vector<double> weights = {0.4, 0.3, 0.2, 0.1};
+  std::mt19937 rng(3);
+  std::normal_distribution<double> loss(0.0, 0.1);
+
+  Eigen::MatrixXd assetLosses(nSimulations, nAssets);
+  for (Eigen::Index i = 0; i < assetLosses.rows(); ++i) {
+    for (Eigen::Index j = 0; j < assetLosses.cols(); ++j) assetLosses(i, j) = loss(rng);
+  }
+  const Eigen::VectorXd portfolioLosses =
+      assetLosses * Eigen::Map<const Eigen::VectorXd>(weights.data(), nAssets);
+
+  // Three shards, merged back to front
+  std::vector<TailAccumulator> shards(3, TailAccumulator(nAssets, nSimulations, alpha));
+  for (size_t i = 0; i < nSimulations; ++i) {
+    const auto row = static_cast<Eigen::Index>(i);
+    shards[i % 3].add(i, portfolioLosses(row), assetLosses.row(row));
+  }
+  TailAccumulator merged = shards[2];
+  merged.merge(shards[1]);
+  merged.merge(shards[0]);
+
+  for (const RiskMeasure measure : {RiskMeasure::VaR, RiskMeasure::ES}) {
+    const double diff = maxDifference(merged.riskMeasures(weights, measure),
+                                      computePortfolioRiskMeasures(assetLosses, weights, alpha, measure));
+    std::cout << "Merged shards kept " << merged.size() << " of " << merged.count()
+              << " scenarios | max difference: " << diff << std::endl;
+    if (diff > tolerance) ++failures;
+  }
+
+  return failures == 0 ? 0 : 1;
+}
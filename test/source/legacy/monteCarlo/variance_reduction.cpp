@@ -0,0 +1,75 @@
+//
+// Created by user on 10/15/26.
+//
+
+#include <cmath>
+#include <iostream>
+#include <numeric>
+#include <vector>
+
+#include "quantdream/legacy/monteCarlo/engine.h"
+#include "syntheticData.h"
+
+int main() {
+  /** Example of usage of the Latin hypercube design
+   * Paths of two blocks, so the loss of a path is mostly fixed by the ranks of its two block
+   * starts: stratifying those ranks must not raise the variance of the ES over independent
+   * draws, and the standard error the engine reports from its replicates must match the
+   * spread of the ES over seeds.
+   */
+
+  // -------------------------------------------------------
+  // Parameters
+  // -------------------------------------------------------
+  const YFData data = makeSyntheticData(600, 4);
+  const size_t nSimulations = 2000;
+  const size_t nSamples = 10;
+  const size_t blockSize = 5;
+  const size_t alpha = 5;
+  const size_t nSeeds = 20;
+  const std::vector<double> weights = {0.4, 0.3, 0.2, 0.1};
+
+  int failures = 0;
+
+  // -------------------------------------------------------
+  // Example 1: ES over seeds, independent draws against the stratified design
+  // -------------------------------------------------------
+  std::vector<double> variances;
+  for (const VarianceReduction design : {VarianceReduction::None, VarianceReduction::Stratified}) {
+    std::vector<double> estimates;
+    double reportedError = 0.0;
+    double effectiveSize = 0.0;
+    for (size_t seed = 0; seed < nSeeds; ++seed) {
+      MonteCarloEngine mc(data, nSimulations, nSamples, blockSize, alpha);
+      mc.selectCategory("Close");
+      mc.setSeed(100 + seed);
+      mc.setNumThreads(4);
+      mc.setScenarioStorage(ScenarioStorage::Losses);
+      mc.setWeights(weights);
+      mc.setVarianceReduction(design);
+      mc.runSimulation(SimulationMethod::Vanilla, 10.0);
+      mc.computeRiskContributions(RiskMeasure::ES);
+      estimates.push_back(mc.getPortfolioLoss());
+      reportedError += mc.getRiskPrecision().standardError / static_cast<double>(nSeeds);
+      effectiveSize += mc.getRiskPrecision().effectiveSampleSize / static_cast<double>(nSeeds);
+    }
+
+    const double mean = std::accumulate(estimates.begin(), estimates.end(), 0.0) / static_cast<double>(nSeeds);
+    double variance = 0.0;
+    for (const double e : estimates) variance += (e - mean) * (e - mean) / static_cast<double>(nSeeds - 1);
+    variances.push_back(variance);
+
+    // The spread over 20 seeds is itself known to about 16%
+    const double ratio = reportedError / std::sqrt(variance);
+    std::cout << (design == VarianceReduction::None ? "Independent" : "Stratified ")
+              << " | ES = " << mean << " +- " << std::sqrt(variance) << " over seeds"
+              << "\t| reported SE = " << reportedError << " (ratio " << ratio << ")"
+              << "\t| ESS = " << effectiveSize << std::endl;
+    if (!(ratio > 0.6 && ratio < 1.5)) ++failures;
+  }
+
+  std::cout << "Variance ratio, stratified over independent: " << variances[1] / variances[0] << std::endl;
+  if (!(variances[1] <= variances[0])) ++failures;
+
+  return failures == 0 ? 0 : 1;
+}